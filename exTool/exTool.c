@@ -226,7 +226,9 @@ void exportLoaded(loadedFile_t *this, char* ip, char* l4port) {
     fbTemplate_t    *tmpl_in;
     fBuf_t          *fbuf;
     uint16_t         tid, tid_in;
+#if VER3
     int              i;
+#endif
     GError          *err = NULL;
 
 #if EXP_FILE
@@ -275,11 +277,17 @@ void exportLoaded(loadedFile_t *this, char* ip, char* l4port) {
         FATAL(err);
 #endif
     uint8_t *cur = this->actualData;
+#if VER3
     for (i = 0; i < this->flowCount; ++i) {
       if (!fBufAppend(fbuf, cur, this->flowLen, &err))
             FATAL(err);
       cur += this->flowLen;
     }
+#else
+    if (!fBufAppendBatch(fbuf, cur, this->flowLen, this->flowCount, NULL,
+                         &err))
+        FATAL(err);
+#endif
 
     if (!fBufEmit(fbuf, &err))
         FATAL(err);
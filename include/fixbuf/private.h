@@ -200,6 +200,25 @@ typedef struct fbTemplateOptRec_st {
     /* fbSubTemplateList_t info_element_list; */
 } fbTemplateOptRec_t;
 
+/**
+ * Returns the key of information element `ie` in a template's index: its
+ * enterprise number, element number, and multiple IE index, ordered so
+ * that comparing keys compares the elements.
+ */
+#define FB_TMPL_INDEX_KEY(ie)                                           \
+    (((uint64_t)(ie)->ent << 32) | ((uint64_t)(ie)->num << 16)          \
+     | (uint16_t)(ie)->midx)
+
+/**
+ * An entry in a template's index of its information elements.
+ */
+typedef struct fbTemplateIndex_st {
+    /** The element's key, from FB_TMPL_INDEX_KEY() */
+    uint64_t            key;
+    /** Position of the element in the template's ie_ary */
+    uint16_t            pos;
+} fbTemplateIndex_t;
+
 /**
  * An IPFIX template or options template structure. Part of the private
  * interface. Applications should use the fbTemplate calls defined in public.h
@@ -239,8 +258,13 @@ struct fbTemplate_st {
     gboolean            is_varlen;
     /** Ordered array of pointers to information elements in this template. */
     fbInfoElement_t     **ie_ary;
-    /** Map of information element to index in ie_ary. */
-    GHashTable          *indices;
+    /**
+     * Index of the information elements in ie_ary, sorted by key.  Has
+     * one entry per element successfully appended to the template.
+     */
+    fbTemplateIndex_t   *indices;
+    /** Number of entries in indices */
+    uint16_t            index_count;
     /** Field offset cache. For internal use by the transcoder. */
     uint16_t            *off_cache;
     /** TRUE if this template has been activated (is no longer mutable) */
@@ -474,6 +498,23 @@ void                fbTemplateRelease(
 void                fbTemplateFree(
     fbTemplate_t        *tmpl);
 
+/**
+ * fbTemplateFindIndex
+ *
+ * Finds the position of an information element in a template, matching
+ * its enterprise number, element number, and multiple IE index.
+ *
+ * @param tmpl
+ * @param ie
+ * @param index Set to the position of `ie` in the template when found
+ *
+ * @return TRUE if the template contains `ie`, FALSE otherwise
+ */
+gboolean            fbTemplateFindIndex(
+    const fbTemplate_t      *tmpl,
+    const fbInfoElement_t   *ie,
+    uint16_t                *index);
+
 /**
  * fbTemplateDebug
  *
@@ -543,6 +584,10 @@ void *fbSessionNewTemplateCallbackAppCtx(
 /**
  * fbSessionClone
  *
+ * Creates a new session with the information model, internal templates,
+ * new template callback, and template pairs of `base`.  The template
+ * pairs are shared with `base` until either session changes them.
+ *
  * @param base
  *
  */
@@ -884,6 +929,45 @@ gboolean            fbCollectMessage(
     size_t              *msglen,
     GError              **err);
 
+/**
+ * fbCollectMessageSize
+ *
+ * Returns in msglen the size of buffer that fbCollectMessage() needs for
+ * the next message of a collector.  For file and TCP transport, this
+ * reads the message header, and so may block; for batched UDP, it may
+ * receive the next batch.  Returns one more than FB_MSGLEN_MAX when the
+ * length is not known until the message is read, or when a translator
+ * may grow the message.
+ *
+ * @param collector
+ * @param msglen
+ * @param err
+ *
+ */
+gboolean            fbCollectMessageSize(
+    fbCollector_t       *collector,
+    size_t              *msglen,
+    GError              **err);
+
+/**
+ * fbCollectMessageMapped
+ *
+ * Returns the next message of a collector from fbCollectorAllocMmap() in
+ * place, without copying it.  For any other collector, sets msgbase to NULL
+ * and returns TRUE; the caller should use fbCollectMessage() instead.
+ *
+ * @param collector
+ * @param msgbase
+ * @param msglen
+ * @param err
+ *
+ */
+gboolean            fbCollectMessageMapped(
+    fbCollector_t       *collector,
+    uint8_t             **msgbase,
+    size_t              *msglen,
+    GError              **err);
+
 /**
  * fbCollectorGetFD
  *
@@ -924,6 +1008,19 @@ void                fbCollectorFree(
 gboolean        fbCollectorHasTranslator(
     fbCollector_t   *collector);
 
+/**
+ * fbCollectorHasBufferedMessage
+ *
+ * Returns TRUE if buffered reads are enabled on the collector and its
+ * receive buffer holds a complete message, which will be returned
+ * without waiting on the socket.
+ *
+ * @param collector
+ *
+ */
+gboolean        fbCollectorHasBufferedMessage(
+    fbCollector_t   *collector);
+
 
 /**
  * fbCollectMessageBuffer
@@ -992,6 +1089,22 @@ void fbListenerRemove(
     fbListener_t        *listener,
     int                 fd);
 
+/**
+ * fbListenerQueueBufferedMessage
+ *
+ * Called by a collector after a read that leaves a complete message in
+ * its receive buffer.  Since the message does not make the collector's
+ * socket readable, the listener returns the collector's buffer from its
+ * next wait without waiting on the socket.
+ *
+ * @param listener
+ * @param fd the collector's file descriptor
+ *
+ */
+void fbListenerQueueBufferedMessage(
+    fbListener_t        *listener,
+    int                 fd);
+
 /**
  * fbListenerGetConnSpec
  *
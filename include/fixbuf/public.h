@@ -750,6 +750,17 @@
  * Fixbuf will return FB_ERROR_SFLOW if it tries to process any
  * malformed samples.
  *
+ * Applications that only need the decoded samples can avoid encoding them
+ * as IPFIX and decoding them again by calling
+ * fbCollectorSetSFlowCallbacks() after fbCollectorSetSFlowTranslator().
+ * Each flow sample is then handed to the callback as an @ref
+ * fbSFlowRecord_t and each counter sample as an @ref
+ * fbSFlowCounterRecord_t while the datagram is being read.  The callbacks
+ * are invoked from within fBufNextMessage(), so the application still
+ * reads the buffer, typically with fBufNext() in automatic mode; a
+ * datagram whose samples were all handed to callbacks produces no IPFIX
+ * records.
+ *
  * @page spread Spread Collectors
  *
  * How-To Use the Spread Protocol
@@ -1215,6 +1226,12 @@ extern "C" {
  * Internal template with defaulted element sizes
  */
 #define FB_ERROR_LAXSIZE            16
+/**
+ * All message buffers of an exporter's writer thread are in use; see
+ * fbExporterSetWriterThread().  The message was not exported and may be
+ * emitted again.
+ */
+#define FB_ERROR_BUSY               17
 
 /*
  * Public Datatypes and Constants
@@ -1240,7 +1257,8 @@ typedef struct fbVarfield_st {
      * Content buffer. In network byte order as appropriate. On write, this
      * buffer will be copied into the message buffer. On read, this buffer
      * points into the message buffer and must be copied by the caller before
-     * any call to fBufNext().
+     * the next call to fBufNext(), fBufNextBatch(), fBufNextView(), or
+     * fBufNextMessage().
      */
     uint8_t     *buf;
 } fbVarfield_t;
@@ -1799,6 +1817,29 @@ typedef struct fbInfoElementOptRec_st {
  */
 typedef struct fbTemplate_st fbTemplate_t;
 
+/**
+ * A zero-copy view of a single record in an IPFIX message buffer, as
+ * returned by fBufNextView().  The record is left in its wire encoding;
+ * individual fields are decoded on demand with fbRecordViewGetUnsigned(),
+ * fbRecordViewGetSigned(), and fbRecordViewGetVarfield(), and the whole
+ * record may be transcoded with fBufTranscodeView().  A view points into
+ * the message buffer and is valid only until the next read from that
+ * buffer.
+ */
+typedef struct fbRecordView_st {
+    /** External template describing the record. */
+    fbTemplate_t        *tmpl;
+    /** Pointer to the first byte of the record in the message buffer. */
+    uint8_t             *base;
+    /** Length of the record in the message buffer. */
+    size_t              len;
+    /**
+     * Offset of each field from `base`, indexed by the position of the
+     * field in `tmpl`. The final entry is the length of the record.
+     */
+    const uint16_t      *offsets;
+} fbRecordView_t;
+
 /**
  * Convenience macro defining a null information element specification
  * initializer (@ref fbInfoElementSpec_t) to terminate a constant information
@@ -2920,6 +2961,42 @@ void fBufListFree(
     fbTemplate_t     *tmpl,
     uint8_t          *record);
 
+/**
+ * Enables or disables the list arena of a buffer.  While the arena is
+ * enabled, the storage for the content of basicLists, subTemplateLists,
+ * and subTemplateMultiLists decoded by fBufNext() is carved out of large
+ * blocks owned by the buffer instead of being allocated separately for
+ * each list.  The storage is then released all at once by
+ * fBufResetListArena(), typically after the application has finished
+ * with a record or with a batch of records.
+ *
+ * While the arena is enabled, fBufListFree() and the list Clear and Free
+ * functions MUST NOT be called on decoded records; the application must
+ * instead zero the list elements of a record buffer (e.g., with memset())
+ * before each read, and call fBufResetListArena() once none of the lists
+ * decoded since the previous reset are in use.
+ *
+ * Changing the setting releases any storage held by the arena.
+ *
+ * @param fbuf       an IPFIX message buffer
+ * @param block_size minimum size in bytes of each block allocated by the
+ *                   arena, or 0 to disable the arena and return to
+ *                   allocating each list separately.
+ */
+void fBufSetListArena(
+    fBuf_t           *fbuf,
+    size_t            block_size);
+
+/**
+ * Releases all list content decoded into the list arena of a buffer since
+ * the previous reset.  Any list structures that point at that content
+ * become invalid.  Does nothing if the arena is not enabled.
+ *
+ * @param fbuf       an IPFIX message buffer
+ */
+void fBufResetListArena(
+    fBuf_t           *fbuf);
+
 
 /**
  * Allocates and returns an empty listenerGroup.  Use
@@ -2953,6 +3030,27 @@ int fbListenerGroupAddListener(
     fbListenerGroup_t          *group,
     const fbListener_t         *listener);
 
+/**
+ * Makes fbListenerGroupWait() wait on the group with epoll(7) instead of
+ * poll(2).  Every listener in the group, and every listener added to it
+ * later, is switched to epoll as by fbListenerEnableEpoll(), and each
+ * wakeup costs time in proportion to the number of ready connections
+ * rather than the number of connections.  fbListenerGroupWait() returns
+ * a result for each connection with input and for each new connection
+ * accepted, as with poll(2).
+ *
+ * fbListenerGroupAddListener() returns 1 if a listener added to an epoll
+ * group cannot be switched to epoll.
+ *
+ * @param group     pointer to the allocated group
+ * @param err       An error description, set on failure.
+ * @return TRUE on success; FALSE on error or if the platform does not
+ *         support epoll.
+ */
+gboolean fbListenerGroupEnableEpoll(
+    fbListenerGroup_t          *group,
+    GError                     **err);
+
 /**
  * Removes the listener from the group.
  * IT DOES NOT FREE THE LISTENER OR THE GROUP
@@ -3212,6 +3310,24 @@ gboolean         fBufSetAutomaticInsert(
 fbSession_t         *fBufGetSession(
     fBuf_t              *fbuf);
 
+/**
+ * Retrieves statistics on the transcode plan cache of a buffer.  A
+ * transcode plan is built for each pair of internal and external templates
+ * a buffer transcodes between, and is reused for later records with the
+ * same pair.  A large number of misses relative to records processed
+ * indicates that templates are being replaced frequently.
+ *
+ * @param fbuf      an IPFIX message buffer
+ * @param hits      if not NULL, set to the number of record transcodes that
+ *                  reused a cached plan.
+ * @param misses    if not NULL, set to the number of plans built.
+ */
+
+void                fBufGetTranscodePlanStats(
+    fBuf_t              *fbuf,
+    uint64_t            *hits,
+    uint64_t            *misses);
+
 /**
  * Frees a buffer. Also frees any associated session, exporter, or collector,
  * closing exporting process or collecting process endpoint connections
@@ -3328,6 +3444,39 @@ gboolean            fBufAppend(
     size_t              recsize,
     GError              **err);
 
+/**
+ * Appends an array of records to a buffer.  Each record is described by the
+ * present internal template and written using the present export template,
+ * as for fBufAppend().  Record `i` is read from `recbase + i * stride`, and
+ * `stride` is also used as the size of each internal record.  Records are
+ * written into the current message until it is full; in automatic mode the
+ * message is then emitted via fBufEmit() and appending continues in a new
+ * message.
+ *
+ * This is equivalent to calling fBufAppend() on each record in turn, but
+ * avoids repeating the per-record template and header checks.
+ *
+ * @param fbuf      an IPFIX message buffer
+ * @param recbase   pointer to an array of internal records
+ * @param stride    distance in bytes between the start of consecutive
+ *                  records in `recbase`
+ * @param count     number of records in `recbase`
+ * @param appended  if not NULL, set to the number of records appended,
+ *                  which is less than `count` on failure.
+ * @param err       an error description, set on failure.
+ *                  Must not be NULL, as it is used internally in
+ *                  automatic mode to detect message restart.
+ * @return TRUE if all records were appended, FALSE on failure.
+ */
+
+gboolean            fBufAppendBatch(
+    fBuf_t              *fbuf,
+    uint8_t             *recbase,
+    size_t              stride,
+    size_t              count,
+    size_t              *appended,
+    GError              **err);
+
 /**
  * Emits the message currently in a buffer using the associated exporting
  * process endpoint.
@@ -3420,6 +3569,13 @@ void                fBufSetCollector(
  * those must be represented in the record at recbase by @ref fbVarfield_t
  * structures.
  *
+ * Variable length fields, and the contents of any lists, decoded into the
+ * record point into the message buffer.  They are valid only until the next
+ * call to fBufNext(), fBufNextBatch(), fBufNextView(), or fBufNextMessage()
+ * on `fbuf`: at the end of each message the message buffer is returned to
+ * a pool shared by all buffers.  Copy any such content that is needed
+ * longer.
+ *
  * @param fbuf      an IPFIX message buffer
  * @param recbase   pointer to internal record buffer; will contain
  *                  record data after call.
@@ -3438,6 +3594,170 @@ gboolean            fBufNext(
     size_t              *recsize,
     GError              **err);
 
+/**
+ * Retrieves multiple records from a Buffer associated with a collecting
+ * process.  Behaves as fBufNext() for the first record, then decodes the
+ * remaining records of the same data set, up to a total of `max` records,
+ * without the per-record overhead of fBufNext().  Every record is decoded
+ * using the internal template set via fBufSetInternalTemplate(), and the
+ * external template of the current data set.  Record `i` is written at
+ * `recbase + i * stride`, and at most `stride` bytes are written for each
+ * record.
+ *
+ * The records returned by a single call always come from a single data
+ * set; call fBufGetCollectionTemplate() to get the external template that
+ * describes them.  When the data set is exhausted before `max` records have
+ * been read, the call returns early; the next call moves to the next data
+ * set (or message, in automatic mode).
+ *
+ * On failure, `count` is set to the number of records that were decoded
+ * before the error occurred, and those records are valid.  As with
+ * fBufNext(), variable length fields and list contents in the records are
+ * valid only until the next call that reads from `fbuf`.
+ *
+ * @param fbuf      an IPFIX message buffer
+ * @param recbase   pointer to an array of internal record buffers; will
+ *                  contain record data after call.
+ * @param stride    distance in bytes between the start of consecutive
+ *                  records in `recbase`; also the maximum size of each
+ *                  record.
+ * @param max       maximum number of records to read.
+ * @param count     on return, the number of records read into `recbase`.
+ * @param err       an error description, set on failure.
+ *                  Must not be NULL, as it is used internally in
+ *                  automatic mode to detect message restart.
+ * @return TRUE on success, FALSE on failure.
+ */
+
+gboolean            fBufNextBatch(
+    fBuf_t              *fbuf,
+    uint8_t             *recbase,
+    size_t              stride,
+    size_t              max,
+    size_t              *count,
+    GError              **err);
+
+/**
+ * Retrieves a record from a Buffer associated with a collecting process
+ * without transcoding it.  Behaves as fBufNext() with respect to messages
+ * and sets, but rather than copying the record into an internal template
+ * layout, fills in `view` with a pointer to the record in the message
+ * buffer and the offsets of its fields.  No internal template is needed.
+ *
+ * Fields may then be read individually with the fbRecordView accessors,
+ * which convert only the requested field from network byte order; this
+ * is cheaper than fBufNext() when most records are discarded after
+ * examining a few fields.  Use fBufTranscodeView() to decode a record
+ * that is kept.
+ *
+ * The view is valid until the next call to any function that reads from
+ * `fbuf`.
+ *
+ * @param fbuf      an IPFIX message buffer
+ * @param view      the record view to fill in.
+ * @param err       an error description, set on failure.
+ *                  Must not be NULL, as it is used internally in
+ *                  automatic mode to detect message restart.
+ * @return TRUE on success, FALSE on failure.
+ */
+
+gboolean            fBufNextView(
+    fBuf_t              *fbuf,
+    fbRecordView_t      *view,
+    GError              **err);
+
+/**
+ * Transcodes a record previously returned by fBufNextView() into the
+ * layout of the internal template set via fBufSetInternalTemplate(), as
+ * fBufNext() would have.  Must be called before the view is invalidated
+ * by the next read from `fbuf`.
+ *
+ * @param fbuf      the IPFIX message buffer that returned `view`
+ * @param view      a valid record view.
+ * @param recbase   pointer to internal record buffer; will contain
+ *                  record data after call.
+ * @param recsize   On call, pointer to size of internal record buffer
+ *                  in bytes. Contains number of bytes actually transcoded
+ *                  at end of call.
+ * @param err       an error description, set on failure.
+ * @return TRUE on success, FALSE on failure.
+ */
+
+gboolean            fBufTranscodeView(
+    fBuf_t              *fbuf,
+    const fbRecordView_t *view,
+    uint8_t             *recbase,
+    size_t              *recsize,
+    GError              **err);
+
+/**
+ * Finds the position of an information element in the template of a
+ * record view, for use with the other fbRecordView accessors.  The
+ * position depends only on the template, so it may be looked up once per
+ * template rather than once per record.
+ *
+ * @param view      a valid record view.
+ * @param ie        the information element to find; the `midx` member
+ *                  selects among repeated instances of the element.
+ * @param index     on success, the position of `ie` in the template.
+ * @return TRUE if the template contains `ie`, FALSE otherwise.
+ */
+
+gboolean            fbRecordViewFindElement(
+    const fbRecordView_t *view,
+    const fbInfoElement_t *ie,
+    uint16_t            *index);
+
+/**
+ * Returns the content of a field of a record view, without copying.  For
+ * variable-length fields the length prefix is skipped; list fields are
+ * returned in their encoded form.  The content is in network byte order.
+ *
+ * @param view      a valid record view.
+ * @param index     position of the field in the template of the view.
+ * @param value     on success, points at the field content.
+ * @return TRUE on success, FALSE if `index` is out of range.
+ */
+
+gboolean            fbRecordViewGetVarfield(
+    const fbRecordView_t *view,
+    uint16_t            index,
+    fbVarfield_t        *value);
+
+/**
+ * Decodes a fixed-length field of one to eight octets of a record view
+ * as an unsigned integer in host byte order.  Reduced-length encodings
+ * are expanded.
+ *
+ * @param view      a valid record view.
+ * @param index     position of the field in the template of the view.
+ * @param value     on success, the value of the field.
+ * @return TRUE on success, FALSE if `index` is out of range or the field
+ *         is not a fixed-length field of at most eight octets.
+ */
+
+gboolean            fbRecordViewGetUnsigned(
+    const fbRecordView_t *view,
+    uint16_t            index,
+    uint64_t            *value);
+
+/**
+ * Decodes a fixed-length field of one to eight octets of a record view
+ * as a signed integer in host byte order.  Reduced-length encodings are
+ * sign-extended.
+ *
+ * @param view      a valid record view.
+ * @param index     position of the field in the template of the view.
+ * @param value     on success, the value of the field.
+ * @return TRUE on success, FALSE if `index` is out of range or the field
+ *         is not a fixed-length field of at most eight octets.
+ */
+
+gboolean            fbRecordViewGetSigned(
+    const fbRecordView_t *view,
+    uint16_t            index,
+    int64_t             *value);
+
 /**
  * Reads a new message into a buffer using the associated collecting
  * process endpoint. Called by fBufNext() on end of message in automatic
@@ -4769,6 +5089,200 @@ void                fbExporterAutoStream(
 void                fbExporterClose(
     fbExporter_t       *exporter);
 
+/**
+ * Enables or disables batched writes on a UDP, TCP, or file
+ * @ref fbExporter_t.  By default, each message emitted by fBufEmit() is
+ * written with its own system call.
+ *
+ * With a batch size of 2 or more, the exporter copies each emitted message
+ * into a queue and writes the queue when it holds `max_messages` messages,
+ * or when a message is emitted more than `max_delay_ms` milliseconds after
+ * the oldest queued message.  UDP messages are sent with a single
+ * sendmmsg(2) call per batch, preserving datagram boundaries; TCP and file
+ * messages are written as one contiguous block.
+ *
+ * With a writer thread (see fbExporterSetWriterThread()), the thread also
+ * writes the queue once its oldest message has waited `max_delay_ms`
+ * milliseconds, even if nothing more is emitted.  Without one, the delay
+ * is only checked as messages are emitted, so an application that may
+ * stop emitting for a while should call fbExporterFlush() when the time
+ * returned by fbExporterGetFlushTimeout() has passed.  Queued messages are
+ * also written by fbExporterClose() and fbExporterFree().  Changing the
+ * batch size writes any queued messages first.
+ *
+ * @param exporter      an exporting process endpoint.
+ * @param max_messages  the number of messages to queue before writing, at
+ *                      most 1024; 0 or 1 disables batching.
+ * @param max_delay_ms  the longest time in milliseconds a message waits in
+ *                      the queue before the next emission writes it; 0 to
+ *                      wait only for the queue to fill.
+ * @param err           an error description, set on failure.
+ * @return TRUE on success; FALSE if the exporter does not use UDP, TCP, or
+ *         a file, if max_messages is too large, if the exporter uses UDP
+ *         and sendmmsg(2) is not available, or if writing the queued
+ *         messages fails.
+ */
+gboolean            fbExporterSetBatch(
+    fbExporter_t       *exporter,
+    unsigned int        max_messages,
+    unsigned int        max_delay_ms,
+    GError            **err);
+
+/**
+ * Writes any messages queued by an @ref fbExporter_t with batching enabled
+ * by fbExporterSetBatch().  Does nothing if no messages are queued.  As
+ * with fBufEmit(), the exporter is closed if the write fails.
+ *
+ * @param exporter  an exporting process endpoint.
+ * @param err       an error description, set on failure.
+ * @return TRUE on success, FALSE if the write fails.
+ */
+gboolean            fbExporterFlush(
+    fbExporter_t       *exporter,
+    GError            **err);
+
+/**
+ * Returns how long an application event loop may wait before it must call
+ * fbExporterFlush() to honor the `max_delay_ms` given to
+ * fbExporterSetBatch(), in a form suitable as a poll(2) timeout.
+ *
+ * @param exporter  an exporting process endpoint.
+ * @return the number of milliseconds until the oldest queued message has
+ *         waited for the batch delay, rounded up; 0 if it already has; or
+ *         -1 if no flush is due, because no messages are queued, the batch
+ *         has no delay, or a writer thread writes the queue itself.
+ */
+int                 fbExporterGetFlushTimeout(
+    fbExporter_t       *exporter);
+
+/**
+ * Starts, resizes, or stops a writer thread for an @ref fbExporter_t.  By
+ * default, fBufEmit() writes each message itself and returns when the
+ * write completes.
+ *
+ * With a writer thread, fBufEmit() copies the message into one of
+ * `buffers` message buffers and returns immediately, so the application
+ * may build the next message while the thread writes earlier ones in
+ * order.  When all buffers are in use, fBufEmit() waits for one to become
+ * free if `block` is TRUE; otherwise it fails with @ref FB_ERROR_BUSY,
+ * leaving the message in the fBuf to be emitted again later.  Either case
+ * is counted by fbExporterGetWriterStats().
+ *
+ * Since messages are written later, a write error is returned by the next
+ * fBufEmit() or fbExporterFlush() call after it occurs, and the message
+ * given to that call is not exported.  As without a writer thread, the
+ * exporter is closed on a write error and reopened by the next message.
+ *
+ * fbExporterFlush() and fbExporterClose() wait for the thread to write all
+ * messages; fbExporterFree() also stops the thread.  The exporter must not
+ * be used from more than one application thread at a time.
+ *
+ * @param exporter  an exporting process endpoint; not one created by
+ *                  fbExporterAllocBuffer().
+ * @param buffers   the number of message buffers, at most 256; 0 stops the
+ *                  writer thread after it writes all pending messages.
+ * @param block     TRUE to wait for a free message buffer, FALSE to fail
+ *                  with @ref FB_ERROR_BUSY.
+ * @param err       an error description, set on failure.
+ * @return TRUE on success; FALSE if the exporter is a buffer exporter, if
+ *         buffers is too large, if the current writer thread has a write
+ *         error to report, or if the thread cannot be created.
+ */
+gboolean            fbExporterSetWriterThread(
+    fbExporter_t       *exporter,
+    unsigned int        buffers,
+    gboolean            block,
+    GError            **err);
+
+/**
+ * Returns the statistics of an @ref fbExporter_t writer thread started by
+ * fbExporterSetWriterThread().  Both are 0 if the exporter has no writer
+ * thread, and are reset when the thread is resized.
+ *
+ * @param exporter  an exporting process endpoint.
+ * @param messages  set to the number of messages handed to the thread;
+ *                  may be NULL.
+ * @param stalls    set to the number of messages that found all message
+ *                  buffers in use; may be NULL.
+ */
+void                fbExporterGetWriterStats(
+    fbExporter_t       *exporter,
+    uint64_t           *messages,
+    uint64_t           *stalls);
+
+/**
+ * Sync policy callback for a file @ref fbExporter_t in block mode; see
+ * fbExporterSetFileSync().  Called after each block is written to the
+ * file, and once more when the file is closed.
+ *
+ * The callback may also note that the file has grown large enough to
+ * rotate.  Since a new file must begin with the templates, rotation is
+ * done by the application after fBufEmit() returns: free the fBuf and
+ * allocate a new one with a new exporter.
+ *
+ * @param exporter  the exporter that wrote the block.
+ * @param written   the number of bytes written to the current file.
+ * @param closing   TRUE if the file is about to be closed.
+ * @param ctx       the context passed to fbExporterSetFileSync().
+ * @return TRUE to fsync(2) the file now, FALSE otherwise.
+ */
+typedef gboolean (*fbExporterFileSync_fn)(
+    fbExporter_t       *exporter,
+    uint64_t            written,
+    gboolean            closing,
+    void               *ctx);
+
+/**
+ * Enables or disables block mode on a file @ref fbExporter_t created by
+ * fbExporterAllocFile().  By default, each message is written with
+ * fwrite(3) using the default stdio buffering.
+ *
+ * In block mode, the file is opened with open(2), and messages are packed
+ * into a write buffer of `block_size` bytes, rounded up to a multiple of
+ * 4096 and aligned to 4096 bytes.  The buffer is written each time it
+ * fills, and whatever remains is written when the exporter is closed.
+ * Since only full blocks are written, fbExporterFlush() does not write a
+ * partial block.  If `direct` is TRUE, the file is opened with O_DIRECT so
+ * the blocks bypass the page cache; the final partial block is written
+ * after turning O_DIRECT off.  Standard output is never opened with
+ * O_DIRECT.
+ *
+ * Use fbExporterSetFileSync() to decide when the file is synced to
+ * storage.  Block mode cannot be combined with fbExporterSetBatch(): this
+ * function fails with FB_ERROR_IMPL if the exporter is batching, and
+ * fbExporterSetBatch() fails on an exporter in block mode.
+ *
+ * @param exporter      a file exporter that has not yet written a message,
+ *                      or that has been closed by fbExporterClose().
+ * @param block_size    the size of the write buffer in bytes, such as
+ *                      several megabytes; 0 returns to stdio writes.
+ * @param direct        TRUE to open the file with O_DIRECT.
+ * @param err           an error description, set on failure.
+ * @return TRUE on success; FALSE if the exporter is not a file exporter
+ *         from fbExporterAllocFile(), if its file is open, if the buffer
+ *         cannot be allocated, or if `direct` is TRUE and O_DIRECT is not
+ *         available.
+ */
+gboolean            fbExporterSetFileBlock(
+    fbExporter_t       *exporter,
+    size_t              block_size,
+    gboolean            direct,
+    GError            **err);
+
+/**
+ * Sets the sync policy callback of a file @ref fbExporter_t in block mode;
+ * see fbExporterSetFileBlock().  Without a callback, the file is never
+ * explicitly synced.
+ *
+ * @param exporter  an exporting process endpoint.
+ * @param sync_fn   the callback, or NULL to remove it.
+ * @param ctx       a context passed to the callback.
+ */
+void                fbExporterSetFileSync(
+    fbExporter_t          *exporter,
+    fbExporterFileSync_fn  sync_fn,
+    void                  *ctx);
+
 /**
  * Gets the (transcoded) message length that was copied to the exporting
  * buffer upon fBufEmit() when using fbExporterAllocBuffer().
@@ -4833,6 +5347,32 @@ fbCollector_t       *fbCollectorAllocFP(
     void                *ctx,
     FILE                *fp);
 
+/**
+ * Allocates a collecting process endpoint that reads a named file through
+ * a memory mapping.  Like fbCollectorAllocFile(), but instead of copying
+ * each message into the @ref fBuf_t, fBufNextMessage() decodes the message
+ * where it lies in the mapping, and the kernel is advised that the file
+ * will be read sequentially.  This suits reprocessing of large IPFIX files.
+ *
+ * The file must be a regular file; standard input and pipes cannot be
+ * mapped.  Varfield and list contents returned from the buffer remain
+ * valid until the collector is closed or freed, rather than only until the next
+ * read from the buffer.  A memory-mapped collector does not support input
+ * translators; fbCollectorSetNetflowV9Translator() and
+ * fbCollectorSetSFlowTranslator() fail with @ref FB_ERROR_IMPL.
+ *
+ * @param ctx       application context; for application use, retrievable
+ *                  by fbCollectorGetContext()
+ * @param path      path of the file to read.
+ * @param err       An error description, set on failure.
+ * @return a collecting process endpoint, or NULL on failure, including on
+ *         platforms without mmap(2).
+ */
+fbCollector_t       *fbCollectorAllocMmap(
+    void                *ctx,
+    const char          *path,
+    GError              **err);
+
 
 #if HAVE_SPREAD
 /**
@@ -4932,6 +5472,48 @@ fbListener_t        *fbListenerAlloc(
     fbListenerAppFree_fn    appfree,
     GError                  **err);
 
+/**
+ * Allocates a listener whose passive sockets are bound with the
+ * SO_REUSEPORT socket option, so that several listeners, usually one per
+ * worker thread, may listen on the same local endpoint.  Otherwise this
+ * behaves exactly as fbListenerAlloc().
+ *
+ * To spread one UDP port across N threads, each worker thread allocates
+ * its own listener on the same connection specifier with its own session,
+ * and calls fbListenerWait() on it.  Each listener has its own socket,
+ * collector, buffer, and table of UDP peer sessions.  The kernel assigns
+ * each datagram to a socket by a hash of its source and destination
+ * addresses and ports, so each exporter is served by the same worker and
+ * its template state stays with that worker's session.  The assignment
+ * changes when a listener sharing the port is opened or freed, so all
+ * listeners should be allocated before exporters start sending.
+ *
+ * For TCP, the kernel distributes incoming connections among the
+ * listeners in the same way.
+ *
+ * Listeners in different threads must not share an @ref fbSession_t.  The
+ * information model may be shared only if it is not modified while the
+ * workers run; collection may add elements to the model, for example when
+ * reading basicLists of unknown elements, so give each worker its own
+ * model unless all elements are known in advance.
+ *
+ * @param spec      local endpoint connection specifier for UDP or TCP.
+ *                  A copy is made of this, which is freed by listener.
+ * @param session   session state container to clone for each collection
+ *                  buffer created by the listener.  Not freed by listener.
+ * @param appinit   application connection initiation function.
+ * @param appfree   application context free function.
+ * @param err       An error description, set on failure.
+ * @return a new listener, or NULL on failure, including when the
+ *         platform does not support SO_REUSEPORT.
+ */
+fbListener_t        *fbListenerAllocReusePort(
+    fbConnSpec_t            *spec,
+    fbSession_t             *session,
+    fbListenerAppInit_fn    appinit,
+    fbListenerAppFree_fn    appfree,
+    GError                  **err);
+
 /**
  * Frees a listener. Stops listening on the local endpoint, and frees any
  * open buffers still managed by the listener.
@@ -4968,6 +5550,31 @@ fBuf_t              *fbListenerWait(
     fbListener_t            *listener,
     GError                  **err);
 
+/**
+ * Makes a listener wait on its sockets with epoll(7) instead of poll(2),
+ * for listeners with many connections.  Each wakeup of fbListenerWait()
+ * then costs time in proportion to the number of ready connections
+ * instead of the number of connections, the event for a connection leads
+ * directly to its collection buffer, and the limit of 25 connections per
+ * listener that applies to poll(2) is lifted.  The semantics of
+ * fbListenerWait() are unchanged: connections with input or with a
+ * complete buffered message are returned in turn, in the order they
+ * became ready.
+ *
+ * Call this after fbListenerAlloc() and before or between calls to
+ * fbListenerWait(); existing connections are moved to the epoll set.  It
+ * does nothing if the listener already uses epoll.  It has no effect on
+ * fbListenerWaitNoCollectors().
+ *
+ * @param listener  a listener created with a connection specifier
+ * @param err       An error description, set on failure.
+ * @return TRUE on success; FALSE on error or if the platform does not
+ *         support epoll.
+ */
+gboolean            fbListenerEnableEpoll(
+    fbListener_t            *listener,
+    GError                  **err);
+
 /**
  * Waits for an incoming connection, just like fbListenerWait(), except that
  * this function doesn't monitor active collectors.  This allows for a
@@ -5103,6 +5710,193 @@ uint32_t fbCollectorGetSFlowMissed(
     size_t                 peerlen,
     uint32_t               obdomain);
 
+/**
+ * A decoded sFlow flow sample, as passed to an @ref fbCollectorSFlowFlow_fn
+ * callback.  The layout matches the internal template of the sFlow
+ * translator's data records (template ID 0xEEEE).  Addresses are in host
+ * byte order, except those held as octet arrays.
+ */
+typedef struct fbSFlowRecord_st {
+    /** sourceIPv6Address, from IPv6 data or a raw packet header */
+    uint8_t               sourceIPv6Address[16];
+    /** destinationIPv6Address, from IPv6 data or a raw packet header */
+    uint8_t               destinationIPv6Address[16];
+    /** ipNextHopIPv6Address, from extended router data */
+    uint8_t               nextHopIPv6Address[16];
+    /** bgpNextHopIPv6Address, from extended gateway data */
+    uint8_t               bgpNextHopIPv6Address[16];
+    /** collectorIPv6Address, the agent address in the datagram header */
+    uint8_t               collectorIPv6Address[16];
+    /** collectionTimeMilliseconds, the time the datagram was read */
+    uint64_t              collectionTimeMilliseconds;
+    /** systemInitTimeMilliseconds, the agent's uptime */
+    uint64_t              systemUpTime;
+    /** collectorIPv4Address, the agent address in the datagram header */
+    uint32_t              collectorIPv4Address;
+    /** protocolIdentifier */
+    uint8_t               protocolIdentifier;
+    /** ipClassOfService */
+    uint8_t               ipClassOfService;
+    /** sourceIPv4PrefixLength, from extended router data */
+    uint8_t               sourceIPv4PrefixLength;
+    /** destinationIPv4PrefixLength, from extended router data */
+    uint8_t               destinationIPv4PrefixLength;
+    /** sourceIPv4Address */
+    uint32_t              sourceIPv4Address;
+    /** destinationIPv4Address */
+    uint32_t              destinationIPv4Address;
+    /** octetTotalCount, the length of the sampled frame */
+    uint32_t              octetTotalCount;
+    /** packetTotalCount, always 1 */
+    uint32_t              packetTotalCount;
+    /** ingressInterface */
+    uint32_t              ingressInterface;
+    /** egressInterface */
+    uint32_t              egressInterface;
+    /** sourceMacAddress */
+    uint8_t               sourceMacAddress[6];
+    /** destinationMacAddress */
+    uint8_t               destinationMacAddress[6];
+    /** ipNextHopIPv4Address, from extended router data */
+    uint32_t              nextHopIPv4Address;
+    /** bgpSourceAsNumber, from extended gateway data */
+    uint32_t              bgpSourceAsNumber;
+    /** bgpDestinationAsNumber, from extended gateway data */
+    uint32_t              bgpDestinationAsNumber;
+    /** bgpNextHopIPv4Address, from extended gateway data */
+    uint32_t              bgpNextHopIPv4Address;
+    /** samplingPacketInterval */
+    uint32_t              samplingPacketInterval;
+    /** samplingPopulation */
+    uint32_t              samplingPopulation;
+    /** droppedPacketTotalCount */
+    uint32_t              droppedPacketTotalCount;
+    /** selectorId, the agent ID in the datagram header */
+    uint32_t              selectorId;
+    /** vlanId */
+    uint16_t              vlanId;
+    /** sourceTransportPort */
+    uint16_t              sourceTransportPort;
+    /** destinationTransportPort */
+    uint16_t              destinationTransportPort;
+    /** tcpControlBits */
+    uint16_t              tcpControlBits;
+    /** dot1qVlanId, from extended switch data */
+    uint16_t              dot1qVlanId;
+    /** postDot1qVlanId, from extended switch data */
+    uint16_t              postDot1qVlanId;
+    /** dot1qPriority, from extended switch data */
+    uint8_t               dot1qPriority;
+} fbSFlowRecord_t;
+
+/**
+ * A decoded sFlow generic interface counter sample, as passed to an @ref
+ * fbCollectorSFlowCounter_fn callback.  The layout matches the internal
+ * template of the sFlow translator's options records (template ID
+ * 0xEEEF).  The information element each member is exported as is
+ * listed in the @ref sflow "sFlow" documentation.
+ */
+typedef struct fbSFlowCounterRecord_st {
+    /** collectorIPv6Address, the agent address in the datagram header */
+    uint8_t          ipv6[16];
+    /** collectionTimeMilliseconds, the time the datagram was read */
+    uint64_t         ctime;
+    /** systemInitTimeMilliseconds, the agent's uptime */
+    uint64_t         sysuptime;
+    /** collectorIPv4Address, the agent address in the datagram header */
+    uint32_t         ipv4;
+    /** ingressInterface, ifIndex */
+    uint32_t         ingress;
+    /** octetTotalCount, ifInOctets */
+    uint64_t         inoct;
+    /** ingressInterfaceType, ifType */
+    uint32_t         ingressType;
+    /** packetTotalCount, ifInUcastPkts */
+    uint32_t         inpkt;
+    /** ingressMulticastPacketTotalCount, ifInMulticastPkts */
+    uint32_t         inmulti;
+    /** ingressBroadcastPacketTotalCount, ifInBroadcastPkts */
+    uint32_t         inbroad;
+    /** notSentPacketTotalCount, ifInDiscards */
+    uint32_t         indiscard;
+    /** droppedPacketTotalCount, ifInErrors */
+    uint32_t         inerr;
+    /** postOctetTotalCount, ifOutOctets */
+    uint64_t         outoct;
+    /** ignoredPacketTotalCount, ifInUnknownProtos */
+    uint32_t         inunknown;
+    /** postPacketTotalCount, ifOutUcastPkts */
+    uint32_t         outpkt;
+    /** egressBroadcastPacketTotalCount, ifOutBroadcastPkts */
+    uint32_t         outbroad;
+    /** selectorId, the agent ID in the datagram header */
+    uint32_t         agentid;
+} fbSFlowCounterRecord_t;
+
+/**
+ * The signature of a callback that receives sFlow flow samples directly
+ * from the sFlow translator.  See fbCollectorSetSFlowCallbacks().
+ *
+ * @param collector the collector reading the sFlow datagram
+ * @param record    the decoded flow sample; valid only during the call
+ * @param ctx       the context pointer given to
+ *                  fbCollectorSetSFlowCallbacks()
+ * @param err       an error description to set when returning FALSE
+ * @return TRUE to continue reading the datagram, FALSE to reject it.
+ */
+typedef gboolean (*fbCollectorSFlowFlow_fn)(
+    fbCollector_t           *collector,
+    const fbSFlowRecord_t   *record,
+    void                    *ctx,
+    GError                  **err);
+
+/**
+ * The signature of a callback that receives sFlow counter samples
+ * directly from the sFlow translator.  See fbCollectorSetSFlowCallbacks().
+ *
+ * @param collector the collector reading the sFlow datagram
+ * @param record    the decoded counter sample; valid only during the call
+ * @param ctx       the context pointer given to
+ *                  fbCollectorSetSFlowCallbacks()
+ * @param err       an error description to set when returning FALSE
+ * @return TRUE to continue reading the datagram, FALSE to reject it.
+ */
+typedef gboolean (*fbCollectorSFlowCounter_fn)(
+    fbCollector_t                   *collector,
+    const fbSFlowCounterRecord_t    *record,
+    void                            *ctx,
+    GError                          **err);
+
+/**
+ * Hands decoded sFlow samples directly to the application rather than
+ * translating them into IPFIX records.  Samples of a kind whose callback
+ * is NULL are translated into IPFIX as before, so either kind may be
+ * read with fBufNext() while the other goes to its callback.  When both
+ * callbacks are set the translator no longer exports its templates and
+ * the first sFlow datagram is processed like any other.
+ *
+ * The callbacks are invoked while fBufNextMessage() reads a datagram,
+ * without the translator's lock held, so a callback may call
+ * fbCollectorGetSFlowMissed() or fbCollectorSetSFlowCallbacks() on the
+ * same collector.  When a callback returns FALSE the rest of the datagram
+ * is discarded and its error is returned from the read.  Set the
+ * callbacks before reading the first message.
+ *
+ * @param collector  a collector with the sFlow translator set
+ * @param flow_fn    callback for flow samples, or NULL
+ * @param counter_fn callback for counter samples, or NULL
+ * @param ctx        context pointer passed to the callbacks
+ * @param err        an error description, set on failure.
+ * @return TRUE on success, FALSE if `collector` does not have the sFlow
+ *         translator set.
+ */
+gboolean    fbCollectorSetSFlowCallbacks(
+    fbCollector_t               *collector,
+    fbCollectorSFlowFlow_fn     flow_fn,
+    fbCollectorSFlowCounter_fn  counter_fn,
+    void                        *ctx,
+    GError                      **err);
+
 /**
  * Retrieves information about the node connected to this collector
  *
@@ -5150,6 +5944,95 @@ void fbCollectorSetUDPMultiSession(
     fbCollector_t *collector,
     gboolean       multi_session);
 
+/**
+ * Enables or disables buffered reads on a TCP @ref fbCollector_t.  The
+ * default setting is that buffered reads are disabled, and each message
+ * costs separate reads of its header and body.
+ *
+ * When buffered reads are enabled, the collector reads as much data as is
+ * available from the socket into an internal buffer of a few hundred
+ * kilobytes, and returns subsequent messages from that buffer without any
+ * system call, waiting on the socket only when the buffer does not hold a
+ * complete message.  This greatly reduces the number of system calls for
+ * high-rate TCP streams.
+ *
+ * Since buffered messages do not make the socket readable,
+ * fbListenerWait() and fbListenerGroupWait() return the buffers whose
+ * collectors hold a complete message without waiting on their sockets.
+ * An application that waits on the collector's socket itself (see
+ * fbCollectorGetFD()) must read all buffered messages before waiting.
+ *
+ * Buffered reads are not used while an input translator is set on the
+ * collector.
+ *
+ * @param collector     a TCP collector, such as one returned by
+ *                      fBufGetCollector() on a buffer returned by
+ *                      fbListenerWait().
+ * @param buffered      TRUE to enable buffered reads, FALSE to disable
+ * @param err           an error description, set on failure.
+ * @return TRUE on success; FALSE if the collector is not a TCP collector,
+ *         or if buffered reads are being disabled while data is buffered.
+ */
+gboolean fbCollectorSetBufferedRead(
+    fbCollector_t *collector,
+    gboolean       buffered,
+    GError       **err);
+
+/**
+ * Sets the number of datagrams a UDP @ref fbCollector_t reads per system
+ * call.  The default batch size is 1, where the collector waits on its
+ * socket and reads a single datagram for each message.
+ *
+ * With a batch size of 2 or more, the collector uses recvmmsg(2) to read
+ * up to `batch_size` datagrams at once into a ring of 64 kilobyte slots,
+ * and returns the following messages from that ring without waiting on the
+ * socket.  Each datagram is still checked against the collector's peer and
+ * session state, and passed through any input translator, as it is
+ * returned.
+ *
+ * Since buffered datagrams do not make the socket readable,
+ * fbListenerWait() and fbListenerGroupWait() return the UDP buffer before
+ * waiting when its collector holds a datagram.  An application that waits
+ * on the collector's socket itself must read all buffered messages before
+ * waiting.
+ *
+ * Changing the batch size resets the statistics returned by
+ * fbCollectorGetUDPBatchStats().
+ *
+ * @param collector     a UDP collector, such as one returned by
+ *                      fbListenerGetCollector().
+ * @param batch_size    the maximum number of datagrams to read at once, at
+ *                      most 1024; 0 or 1 disables batching.
+ * @param err           an error description, set on failure.
+ * @return TRUE on success; FALSE if the collector is not a UDP collector,
+ *         if batch_size is too large, if datagrams are currently
+ *         buffered, or if recvmmsg(2) is not available.
+ */
+gboolean fbCollectorSetUDPBatch(
+    fbCollector_t *collector,
+    unsigned int   batch_size,
+    GError       **err);
+
+/**
+ * Returns the batch fill statistics of a UDP @ref fbCollector_t with
+ * batched reads enabled by fbCollectorSetUDPBatch().  The average number
+ * of datagrams per batch is `datagrams / batches`.  A large share of full
+ * batches means that datagrams are arriving faster than one batch per
+ * wait and that a larger batch size may help.  All values are zero when
+ * batching is disabled.
+ *
+ * @param collector     a UDP collector.
+ * @param batches       if not NULL, set to the number of batches read.
+ * @param datagrams     if not NULL, set to the number of datagrams read.
+ * @param full_batches  if not NULL, set to the number of batches that
+ *                      filled every slot.
+ */
+void fbCollectorGetUDPBatchStats(
+    fbCollector_t *collector,
+    uint64_t      *batches,
+    uint64_t      *datagrams,
+    uint64_t      *full_batches);
+
 
 #ifdef __cplusplus
 } /* extern "C" */
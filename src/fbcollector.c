@@ -39,10 +39,19 @@
  *  ------------------------------------------------------------------------
  */
 
+#ifndef _GNU_SOURCE
+/* for recvmmsg() */
+#define _GNU_SOURCE
+#endif
 #define _FIXBUF_SOURCE_
 #include <fixbuf/private.h>
 
 #include "fbcollector.h"
+#if HAVE_SYS_MMAN_H
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#endif
 
 
 /*#################################################
@@ -317,6 +326,31 @@ static void        fbCollectorSessionTimeoutNull(
  *
  *#################################################*/
 
+/**
+ * fbCollectorFileError
+ *
+ * Sets `err` for a file read that returned `rc` bytes, fewer than were
+ * requested.
+ *
+ */
+static void fbCollectorFileError(
+    fbCollector_t           *collector,
+    int                     rc,
+    GError                  **err)
+{
+    if (feof(collector->stream.fp)) {
+        g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_EOF,
+                    "End of file");
+    } else if (rc > 0) {
+        g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_EOF,
+                    "Too few bytes available for IPFIX Message Header (%d/16)",
+                    rc);
+    } else {
+        g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_IO,
+                    "I/O error: %s", strerror(errno));
+    }
+}
+
 /**
  * fbCollectorReadFile
  *
@@ -335,9 +369,14 @@ static gboolean fbCollectorReadFile(
     /* Read and decode version and length */
     g_assert(*msglen > 4);
 
-    rc = fread(msgbase, 1, 4, collector->stream.fp);
-    if (rc < 4) {
-        goto ERROR;
+    if (collector->vl_pending) {
+        memcpy(msgbase, &collector->vl_next, 4);
+        collector->vl_pending = FALSE;
+    } else {
+        rc = fread(msgbase, 1, 4, collector->stream.fp);
+        if (rc < 4) {
+            goto ERROR;
+        }
     }
     if (!collector->coreadLen(collector, (fbCollectorMsgVL_t *)msgbase,
                               *msglen, &h_len, err))
@@ -359,17 +398,7 @@ static gboolean fbCollectorReadFile(
     return TRUE;
 
   ERROR:
-    if (feof(collector->stream.fp)) {
-        g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_EOF,
-                    "End of file");
-    } else if (rc > 0) {
-        g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_EOF,
-                    "Too few bytes available for IPFIX Message Header (%d/16)",
-                    rc);
-    } else {
-        g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_IO,
-                    "I/O error: %s", strerror(errno));
-    }
+    fbCollectorFileError(collector, rc, err);
     return FALSE;
 }
 
@@ -498,6 +527,178 @@ fbCollector_t *fbCollectorAllocFile(
     return collector;
 }
 
+#if HAVE_SYS_MMAN_H
+/**
+ * fbCollectorNextMapped
+ *
+ * Finds the next message in the mapping of an fbCollectorAllocMmap()
+ * collector and advances past it.
+ *
+ */
+static gboolean fbCollectorNextMapped(
+    fbCollector_t           *collector,
+    uint8_t                 **msgbase,
+    size_t                  *msglen,
+    GError                  **err)
+{
+    size_t                  avail = collector->map_len - collector->map_off;
+    uint8_t                 *hdr = collector->map + collector->map_off;
+    uint16_t                h_len;
+
+    if (0 == avail) {
+        g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_EOF,
+                    "End of file");
+        return FALSE;
+    }
+    if (avail < 4) {
+        g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_EOF,
+                    "Too few bytes available for IPFIX Message Header (%d/16)",
+                    (int)avail);
+        return FALSE;
+    }
+    if (!collector->coreadLen(collector, (fbCollectorMsgVL_t *)hdr,
+                              FB_MSGLEN_MAX, &h_len, err))
+    {
+        return FALSE;
+    }
+    if (h_len > avail) {
+        /* as with fread(), return the truncated message */
+        h_len = avail;
+    }
+
+    collector->map_off += h_len;
+    *msgbase = hdr;
+    *msglen = h_len;
+    return TRUE;
+}
+
+/**
+ * fbCollectorReadMmap
+ *
+ * Copies the next message out of the mapping, for callers that supply
+ * their own buffer.
+ *
+ */
+static gboolean fbCollectorReadMmap(
+    fbCollector_t           *collector,
+    uint8_t                 *msgbase,
+    size_t                  *msglen,
+    GError                  **err)
+{
+    uint8_t                 *mapped;
+    size_t                  maplen;
+
+    if (!fbCollectorNextMapped(collector, &mapped, &maplen, err)) {
+        return FALSE;
+    }
+    if (maplen > *msglen) {
+        g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_BUFSZ,
+                    "IPFIX Message length %u exceeds buffer size %u",
+                    (uint32_t)maplen, (uint32_t)*msglen);
+        return FALSE;
+    }
+    memcpy(msgbase, mapped, maplen);
+    *msglen = maplen;
+    return TRUE;
+}
+
+/**
+ * fbCollectorCloseMmap
+ *
+ *
+ *
+ */
+static void fbCollectorCloseMmap(
+    fbCollector_t   *collector)
+{
+    if (collector->map) {
+        munmap(collector->map, collector->map_len);
+        collector->map = NULL;
+    }
+    collector->map_len = collector->map_off = 0;
+    collector->active = FALSE;
+}
+#endif  /* HAVE_SYS_MMAN_H */
+
+/**
+ * fbCollectorAllocMmap
+ *
+ *
+ *
+ */
+fbCollector_t *fbCollectorAllocMmap(
+    void            *ctx,
+    const char      *path,
+    GError          **err)
+{
+#if HAVE_SYS_MMAN_H
+    fbCollector_t   *collector = NULL;
+    struct stat     st;
+    void            *map = NULL;
+    int             fd;
+
+    fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_IO,
+                    "Couldn't open %s for collection: %s",
+                    path, strerror(errno));
+        return NULL;
+    }
+    if (fstat(fd, &st) != 0) {
+        g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_IO,
+                    "Couldn't stat %s: %s", path, strerror(errno));
+        close(fd);
+        return NULL;
+    }
+    if (!S_ISREG(st.st_mode)) {
+        g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_IO,
+                    "Couldn't map %s: not a regular file", path);
+        close(fd);
+        return NULL;
+    }
+
+    /* an empty file cannot be mapped; it reads as end of file */
+    if (st.st_size > 0) {
+        /* private and writable so that nothing can change the file */
+        map = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE,
+                   fd, 0);
+        if (MAP_FAILED == map) {
+            g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_IO,
+                        "Couldn't map %s: %s", path, strerror(errno));
+            close(fd);
+            return NULL;
+        }
+#ifdef MADV_SEQUENTIAL
+        madvise(map, st.st_size, MADV_SEQUENTIAL);
+#endif
+    }
+    close(fd);
+
+    collector = g_slice_new0(fbCollector_t);
+    collector->ctx = ctx;
+    collector->stream.fd = -1;
+    collector->map = (uint8_t *)map;
+    collector->map_len = st.st_size;
+    collector->active = TRUE;
+    collector->coread = fbCollectorReadMmap;
+    collector->coclose = fbCollectorCloseMmap;
+    collector->copostRead = fbCollectorPostProcNull;
+    collector->coreadLen = fbCollectorDecodeMsgVL;
+    collector->comsgHeader = fbCollectorMessageHeaderNull;
+    collector->cotransClose = fbCollectorCloseTranslatorNull;
+    collector->cotimeOut = fbCollectorSessionTimeoutNull;
+    collector->translationActive = FALSE;
+    collector->rip = -1;
+    collector->wip = -1;
+
+    return collector;
+#else
+    g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_IMPL,
+                "Memory-mapped collection is not supported on this platform");
+    return NULL;
+#endif  /* HAVE_SYS_MMAN_H */
+}
+
 #if FB_ENABLE_SCTP
 
 /**
@@ -588,23 +789,92 @@ static int fbCollectorHandleSelect(
 }
 
 /**
- * fbCollectorReadTCP
+ * fbCollectorFillTCP
  *
+ * Reads from the socket into the receive buffer until it holds at least
+ * `need` bytes.  Each read takes as much as the buffer has room for, so
+ * a single read usually brings in many messages.
  *
+ */
+static gboolean fbCollectorFillTCP(
+    fbCollector_t   *collector,
+    size_t          need,
+    const char      *where,
+    GError          **err)
+{
+    ssize_t                 rc;
+
+    while (collector->rbuf_end - collector->rbuf_off < need) {
+        /* Move the partial message to the front to make room for the rest */
+        if (collector->rbuf_off + need > FB_COLLECTOR_RBUF_SIZE) {
+            memmove(collector->rbuf, collector->rbuf + collector->rbuf_off,
+                    collector->rbuf_end - collector->rbuf_off);
+            collector->rbuf_end -= collector->rbuf_off;
+            collector->rbuf_off = 0;
+        }
+
+        rc = fbCollectorHandleSelect(collector);
+
+        if (rc < 0) {
+            g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_IO,
+                        "Interrupted by pipe");
+            /* interrupted by pipe read or other error with select*/
+            return FALSE;
+        }
+
+        rc = read(collector->stream.fd, collector->rbuf + collector->rbuf_end,
+                  FB_COLLECTOR_RBUF_SIZE - collector->rbuf_end);
+        if (rc > 0) {
+            collector->rbuf_end += rc;
+        } else if (rc == 0) {
+            g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_EOF,
+                        "End of file");
+            return FALSE;
+        } else if (errno == EINTR) {
+            g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_NLREAD,
+                        "TCP read interrupt %s", where);
+            return FALSE;
+        } else {
+            g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_IO,
+                        "TCP I/O error: %s", strerror(errno));
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
+/**
+ * fbCollectorNoteBufferedMessage
+ *
+ * Tells the collector's listener, if any, when the collector holds a
+ * complete message that can be returned without reading the socket.
  *
  */
-static gboolean fbCollectorReadTCP(
+static void fbCollectorNoteBufferedMessage(
+    fbCollector_t   *collector)
+{
+    if (collector->listener && fbCollectorHasBufferedMessage(collector)) {
+        fbListenerQueueBufferedMessage(collector->listener,
+                                       collector->stream.fd);
+    }
+}
+
+/**
+ * fbCollectorReadTCPHeader
+ *
+ * Reads the version and length of the next message from an unbuffered
+ * TCP socket into the 4 bytes at `vl`.
+ *
+ */
+static gboolean fbCollectorReadTCPHeader(
     fbCollector_t   *collector,
-    uint8_t         *msgbase,
-    size_t          *msglen,
+    uint8_t         *vl,
     GError          **err)
 {
     int                     rc;
-    uint16_t                h_len, rrem;
-    gboolean                goodLen;
+    uint16_t                rrem;
 
-    /* Read and decode version and length */
-    g_assert(*msglen > 4);
     rrem = 4;
     while (rrem) {
         rc = fbCollectorHandleSelect(collector);
@@ -616,10 +886,10 @@ static gboolean fbCollectorReadTCP(
             return FALSE;
         }
 
-        rc = read(collector->stream.fd, msgbase, rrem);
+        rc = read(collector->stream.fd, vl, rrem);
         if (rc > 0) {
             rrem -= rc;
-            msgbase += rc;
+            vl += rc;
         } else if (rc == 0) {
             g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_EOF,
                         "End of file");
@@ -634,10 +904,90 @@ static gboolean fbCollectorReadTCP(
             return FALSE;
         }
     }
-    goodLen = collector->coreadLen(collector,
-                                   (fbCollectorMsgVL_t *)(msgbase - 4),
+
+    return TRUE;
+}
+
+/**
+ * fbCollectorReadBufferedTCP
+ *
+ * Returns the next message from the receive buffer, refilling it from
+ * the socket only when it does not hold a complete message.
+ *
+ */
+static gboolean fbCollectorReadBufferedTCP(
+    fbCollector_t   *collector,
+    uint8_t         *msgbase,
+    size_t          *msglen,
+    GError          **err)
+{
+    uint16_t                h_len;
+
+    /* Read and decode version and length */
+    g_assert(*msglen > 4);
+    if (!fbCollectorFillTCP(collector, 4, "at message start", err)) {
+        return FALSE;
+    }
+    memcpy(msgbase, collector->rbuf + collector->rbuf_off, 4);
+    if (!collector->coreadLen(collector, (fbCollectorMsgVL_t *)msgbase,
+                              *msglen, &h_len, err))
+    {
+        return FALSE;
+    }
+
+    /* copy rest of message */
+    if (!fbCollectorFillTCP(collector, h_len, "in message", err)) {
+        return FALSE;
+    }
+    memcpy(msgbase + 4, collector->rbuf + collector->rbuf_off + 4, h_len - 4);
+    collector->rbuf_off += h_len;
+    if (collector->rbuf_off == collector->rbuf_end) {
+        collector->rbuf_off = collector->rbuf_end = 0;
+    }
+    fbCollectorNoteBufferedMessage(collector);
+
+    /* Post process, if needed and return message length from header. */
+    *msglen = h_len;
+    if (!collector->copostRead(collector, msgbase, msglen, err)) {
+        return FALSE;
+    }
+    return TRUE;
+}
+
+/**
+ * fbCollectorReadTCP
+ *
+ *
+ *
+ */
+static gboolean fbCollectorReadTCP(
+    fbCollector_t   *collector,
+    uint8_t         *msgbase,
+    size_t          *msglen,
+    GError          **err)
+{
+    int                     rc;
+    uint16_t                h_len, rrem;
+    gboolean                goodLen;
+
+    /* Translators read parts of the message themselves; only buffer when
+     * collecting IPFIX */
+    if (collector->rbuf && collector->coreadLen == fbCollectorDecodeMsgVL) {
+        return fbCollectorReadBufferedTCP(collector, msgbase, msglen, err);
+    }
+
+    /* Read and decode version and length */
+    g_assert(*msglen > 4);
+    if (collector->vl_pending) {
+        memcpy(msgbase, &collector->vl_next, 4);
+        collector->vl_pending = FALSE;
+    } else if (!fbCollectorReadTCPHeader(collector, msgbase, err)) {
+        return FALSE;
+    }
+    goodLen = collector->coreadLen(collector, (fbCollectorMsgVL_t *)msgbase,
                                    *msglen, &h_len, err);
     if (FALSE == goodLen) return FALSE;
+    msgbase += 4;
 
     /* read rest of message */
     rrem = h_len - 4;
@@ -677,6 +1027,45 @@ static gboolean fbCollectorReadTCP(
     return TRUE;
 }
 
+/**
+ * fbCollectorUDPSpecHash
+ *
+ * Hashes the key of a UDP connection spec: the peer address and the
+ * observation domain.
+ *
+ */
+static guint fbCollectorUDPSpecHash(
+    gconstpointer          key)
+{
+    const fbUDPConnSpec_t *spec = (const fbUDPConnSpec_t *)key;
+    const uint8_t         *cp = (const uint8_t *)&(spec->peer);
+    guint32               hash = 2166136261u ^ spec->obdomain;
+    size_t                i;
+
+    /* FNV-1a over the address bytes */
+    for (i = 0; i < spec->peerlen; i++) {
+        hash = (hash ^ cp[i]) * 16777619u;
+    }
+    return hash;
+}
+
+/**
+ * fbCollectorUDPSpecEqual
+ *
+ * Compares the keys of two UDP connection specs.
+ *
+ */
+static gboolean fbCollectorUDPSpecEqual(
+    gconstpointer          a,
+    gconstpointer          b)
+{
+    const fbUDPConnSpec_t *sa = (const fbUDPConnSpec_t *)a;
+    const fbUDPConnSpec_t *sb = (const fbUDPConnSpec_t *)b;
+
+    return (sa->obdomain == sb->obdomain && sa->peerlen == sb->peerlen &&
+            0 == memcmp(&(sa->peer), &(sb->peer), sa->peerlen));
+}
+
 static void fbCollectorSetUDPSpec(
     fbCollector_t         *collector,
     fbUDPConnSpec_t       *spec)
@@ -735,6 +1124,7 @@ static void fbCollectorFreeUDPSpec(
         fbListenerAppFree(collector->listener, spec->ctx);
     }
 
+    g_hash_table_remove(collector->udp_hash, spec);
     g_slice_free(fbUDPConnSpec_t, spec);
 }
 
@@ -751,6 +1141,7 @@ static gboolean fbCollectorVerifyUDPPeer(
     GError          **err)
 {
     fbUDPConnSpec_t    *udp = collector->udp_head;
+    fbUDPConnSpec_t    key;
     gboolean           found = FALSE;
 
     /* stash the address if we've not seen it before */
@@ -785,26 +1176,33 @@ static gboolean fbCollectorVerifyUDPPeer(
                sizeof(collector->peer) : fromlen);
     }
 
-    while (udp) {
-        /* loop through and find current one */
-        if (udp->obdomain == collector->obdomain) {
-            if (!memcmp(&(udp->peer.so), from, udp->peerlen)) {
-                /* we have a match - set session */
-                fbCollectorSetUDPSpec(collector, udp);
-                found = TRUE;
-                break;
-            }
+    /* build the lookup key */
+    key.peerlen = (fromlen > sizeof(key.peer)) ? sizeof(key.peer) : fromlen;
+    memcpy(&(key.peer.so), from, key.peerlen);
+    key.obdomain = collector->obdomain;
+
+    /* the head of the list is the spec of the previous message */
+    if (udp && fbCollectorUDPSpecEqual(udp, &key)) {
+        found = TRUE;
+    } else {
+        if (collector->udp_hash == NULL) {
+            collector->udp_hash = g_hash_table_new(fbCollectorUDPSpecHash,
+                                                   fbCollectorUDPSpecEqual);
+        }
+        udp = g_hash_table_lookup(collector->udp_hash, &key);
+        if (udp) {
+            /* we have a match - set session */
+            fbCollectorSetUDPSpec(collector, udp);
+            found = TRUE;
         }
-        udp = udp->next;
     }
 
-
     if (!found) {
         udp = g_slice_new0(fbUDPConnSpec_t);
-        memcpy(&(udp->peer.so), from, (fromlen > sizeof(udp->peer)) ?
-               sizeof(udp->peer) : fromlen);
-        udp->peerlen = (fromlen > sizeof(udp->peer)) ? sizeof(udp->peer) : fromlen;
-        udp->obdomain = collector->obdomain;
+        memcpy(&(udp->peer.so), &(key.peer.so), key.peerlen);
+        udp->peerlen = key.peerlen;
+        udp->obdomain = key.obdomain;
+        g_hash_table_insert(collector->udp_hash, udp, udp);
         /* create a new session */
         udp->session = fbListenerSetPeerSession(collector->listener, NULL);
         fbCollectorSetUDPSpec(collector, udp);
@@ -844,6 +1242,174 @@ static gboolean fbCollectorVerifyUDPPeer(
     return TRUE;
 }
 
+#if HAVE_RECVMMSG
+/**
+ * fbCollectorUDPBatch_st
+ *
+ * Batched UDP receive state: a ring of datagram slots filled by a single
+ * recvmmsg() call and consumed one datagram per read.
+ *
+ */
+struct fbCollectorUDPBatch_st {
+    /** recvmmsg() headers, one per slot */
+    struct mmsghdr              *msgs;
+    /** data buffer for each slot */
+    struct iovec                *iov;
+    /** peer address of each slot */
+    union {
+        struct sockaddr         so;
+        struct sockaddr_in      ip4;
+        struct sockaddr_in6     ip6;
+    }                           *peers;
+    /** slot data; FB_COLLECTOR_UDP_SLOT_SIZE bytes per slot */
+    uint8_t                     *data;
+    /** number of slots */
+    unsigned int                size;
+    /** number of slots filled by the last recvmmsg() */
+    unsigned int                fill;
+    /** index of the next slot to return */
+    unsigned int                next;
+    /** number of recvmmsg() calls that returned data */
+    uint64_t                    batches;
+    /** number of datagrams received */
+    uint64_t                    datagrams;
+    /** number of batches that filled every slot */
+    uint64_t                    full;
+};
+
+/**
+ * fbCollectorUDPBatchFree
+ *
+ *
+ */
+static void fbCollectorUDPBatchFree(
+    fbCollectorUDPBatch_t  *batch)
+{
+    g_free(batch->msgs);
+    g_free(batch->iov);
+    g_free(batch->peers);
+    g_free(batch->data);
+    g_slice_free(fbCollectorUDPBatch_t, batch);
+}
+
+/**
+ * fbCollectorFillUDPBatch
+ *
+ * Refills the collector's ring of datagram slots with a single recvmmsg()
+ * when every slot has been returned.
+ *
+ */
+static gboolean fbCollectorFillUDPBatch(
+    fbCollector_t   *collector,
+    GError          **err)
+{
+    fbCollectorUDPBatch_t *batch = collector->udp_batch;
+    unsigned int          i;
+    int                   rc;
+
+    if (batch->next < batch->fill) {
+        return TRUE;
+    }
+
+    rc = fbCollectorHandleSelect(collector);
+
+    if (rc < 0) {
+        g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_IO,
+                    "Interrupted by pipe");
+        /* interrupted by pipe read or other error with select*/
+        return FALSE;
+    }
+
+    for (i = 0; i < batch->size; i++) {
+        batch->msgs[i].msg_hdr.msg_namelen = sizeof(batch->peers[i]);
+        batch->msgs[i].msg_len = 0;
+    }
+
+    /* the socket is readable, so this returns at least one datagram
+     * and does not block for the rest */
+    rc = recvmmsg(collector->stream.fd, batch->msgs, batch->size,
+                  MSG_DONTWAIT, NULL);
+    if (rc <= 0) {
+        batch->fill = batch->next = 0;
+        if (rc == 0 || errno == EINTR || errno == EWOULDBLOCK) {
+            g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_NLREAD,
+                        "UDP read interrupt or timeout");
+        } else {
+            g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_IO,
+                        "UDP I/O error: %s", strerror(errno));
+        }
+        return FALSE;
+    }
+
+    batch->fill = rc;
+    batch->next = 0;
+    ++batch->batches;
+    batch->datagrams += rc;
+    if ((unsigned int)rc == batch->size) {
+        ++batch->full;
+    }
+
+    return TRUE;
+}
+
+/**
+ * fbCollectorReadUDPBatch
+ *
+ * Returns the next datagram from the collector's ring of slots, refilling
+ * the ring with a single recvmmsg() when it has been consumed.
+ *
+ */
+static gboolean fbCollectorReadUDPBatch(
+    fbCollector_t   *collector,
+    uint8_t         *msgbase,
+    size_t          *msglen,
+    GError          **err)
+{
+    fbCollectorUDPBatch_t *batch = collector->udp_batch;
+    struct mmsghdr        *msg;
+    uint16_t              msgSize = 0;
+    size_t                recvlen;
+    unsigned int          i;
+
+    if (!fbCollectorFillUDPBatch(collector, err)) {
+        return FALSE;
+    }
+
+    i = batch->next++;
+    msg = &batch->msgs[i];
+    fbCollectorNoteBufferedMessage(collector);
+
+    recvlen = (msg->msg_len > *msglen) ? *msglen : msg->msg_len;
+    memcpy(msgbase, batch->iov[i].iov_base, recvlen);
+
+    if (batch->peers[i].so.sa_family == AF_INET6) {
+        batch->peers[i].ip6.sin6_flowinfo = 0;
+        batch->peers[i].ip6.sin6_scope_id = 0;
+    }
+
+    if (!collector->comsgHeader(collector, msgbase, recvlen, &msgSize, err)) {
+        return FALSE;
+    }
+
+    if (msgSize == 0) {
+        g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_NLREAD,
+                    "Ignoring empty UDP message");
+        return FALSE;
+    }
+
+    *msglen = msgSize;
+    if (!fbCollectorVerifyUDPPeer(collector, &(batch->peers[i].so),
+                                  msg->msg_hdr.msg_namelen, err))
+    {
+        return FALSE;
+    }
+    if (!collector->copostRead(collector, msgbase, msglen, err)) {
+        return FALSE;
+    }
+    return TRUE;
+}
+#endif /* HAVE_RECVMMSG */
+
 /**
  * fbCollectorReadUDP
  *
@@ -866,6 +1432,12 @@ static gboolean fbCollectorReadUDP(
     }                           peer;
     socklen_t                   peerlen;
 
+#if HAVE_RECVMMSG
+    if (collector->udp_batch) {
+        return fbCollectorReadUDPBatch(collector, msgbase, msglen, err);
+    }
+#endif
+
     memset(&peer, 0, sizeof(peer));
 
     rc = fbCollectorHandleSelect(collector);
@@ -1626,6 +2198,103 @@ gboolean        fbCollectMessage(
     return FALSE;
 }
 
+/**
+ * fbCollectMessageSize
+ *
+ *
+ *
+ */
+gboolean        fbCollectMessageSize(
+    fbCollector_t   *collector,
+    size_t          *msglen,
+    GError          **err)
+{
+    const uint8_t   *vl = NULL;
+    int             rc;
+
+    /* Ensure stream is open */
+    if (!collector->active) {
+        g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_CONN,
+                    "Collector not active");
+        return FALSE;
+    }
+
+    /* Translators may grow a message as they convert it, and other
+     * transports learn the length only when the message is read */
+    *msglen = FB_MSGLEN_MAX + 1;
+    if (collector->coreadLen != fbCollectorDecodeMsgVL) {
+        return TRUE;
+    }
+
+    if (collector->coread == fbCollectorReadFile) {
+        if (!collector->vl_pending) {
+            rc = fread(&collector->vl_next, 1, 4, collector->stream.fp);
+            if (rc < 4) {
+                fbCollectorFileError(collector, rc, err);
+                return FALSE;
+            }
+            collector->vl_pending = TRUE;
+        }
+        vl = (const uint8_t *)&collector->vl_next;
+    } else if (collector->coread == fbCollectorReadTCP) {
+        if (collector->rbuf) {
+            if (!fbCollectorFillTCP(collector, 4, "at message start", err)) {
+                return FALSE;
+            }
+            vl = collector->rbuf + collector->rbuf_off;
+        } else {
+            if (!collector->vl_pending) {
+                if (!fbCollectorReadTCPHeader(
+                        collector, (uint8_t *)&collector->vl_next, err))
+                {
+                    return FALSE;
+                }
+                collector->vl_pending = TRUE;
+            }
+            vl = (const uint8_t *)&collector->vl_next;
+        }
+#if HAVE_RECVMMSG
+    } else if (collector->udp_batch) {
+        if (!fbCollectorFillUDPBatch(collector, err)) {
+            return FALSE;
+        }
+        *msglen =
+            collector->udp_batch->msgs[collector->udp_batch->next].msg_len;
+#endif
+    }
+
+    if (vl) {
+        *msglen = (vl[2] << 8) | vl[3];
+    }
+    return TRUE;
+}
+
+/**
+ * fbCollectMessageMapped
+ *
+ *
+ *
+ */
+gboolean        fbCollectMessageMapped(
+    fbCollector_t   *collector,
+    uint8_t         **msgbase,
+    size_t          *msglen,
+    GError          **err)
+{
+#if HAVE_SYS_MMAN_H
+    if (collector->coread == fbCollectorReadMmap) {
+        if (!collector->active) {
+            g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_CONN,
+                        "Collector not active");
+            return FALSE;
+        }
+        return fbCollectorNextMapped(collector, msgbase, msglen, err);
+    }
+#endif
+    *msgbase = NULL;
+    return TRUE;
+}
+
 /**
  * fbCollectorGetContext
  *
@@ -1724,7 +2393,16 @@ void            fbCollectorFree(
     while (collector->udp_tail) {
         fbCollectorFreeUDPSpec(collector, collector->udp_tail);
     }
+    if (collector->udp_hash) {
+        g_hash_table_destroy(collector->udp_hash);
+    }
 
+    g_free(collector->rbuf);
+#if HAVE_RECVMMSG
+    if (collector->udp_batch) {
+        fbCollectorUDPBatchFree(collector->udp_batch);
+    }
+#endif
     g_slice_free(fbCollector_t, collector);
 }
 
@@ -1786,6 +2464,14 @@ gboolean    fbCollectorSetTranslator(
     void                         *opaque,
     GError                       **err)
 {
+#if HAVE_SYS_MMAN_H
+    if (collector->coread == fbCollectorReadMmap) {
+        g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_IMPL,
+                    "Translators are not supported on memory-mapped "
+                    "collectors");
+        return FALSE;
+    }
+#endif
     if (NULL != collector->translatorState)
     {
         g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_TRANSMISC,
@@ -1866,3 +2552,153 @@ void fbCollectorSetUDPMultiSession(
 {
     collector->multi_session = multi_session;
 }
+
+gboolean fbCollectorSetBufferedRead(
+    fbCollector_t *collector,
+    gboolean       buffered,
+    GError       **err)
+{
+    if (collector->coread != fbCollectorReadTCP) {
+        g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_IMPL,
+                    "Buffered reads are only supported on TCP collectors");
+        return FALSE;
+    }
+
+    if (buffered) {
+        if (!collector->rbuf) {
+            collector->rbuf = g_malloc(FB_COLLECTOR_RBUF_SIZE);
+            collector->rbuf_off = collector->rbuf_end = 0;
+            /* Keep a header read ahead by fbCollectMessageSize() */
+            if (collector->vl_pending) {
+                memcpy(collector->rbuf, &collector->vl_next, 4);
+                collector->rbuf_end = 4;
+                collector->vl_pending = FALSE;
+            }
+        }
+    } else if (collector->rbuf) {
+        if (collector->rbuf_end != collector->rbuf_off) {
+            g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_IMPL,
+                        "Cannot disable buffered reads while data is "
+                        "buffered");
+            return FALSE;
+        }
+        g_free(collector->rbuf);
+        collector->rbuf = NULL;
+    }
+
+    return TRUE;
+}
+
+gboolean fbCollectorHasBufferedMessage(
+    fbCollector_t *collector)
+{
+    const uint8_t *hdr;
+    size_t         avail;
+    uint16_t       h_len;
+
+#if HAVE_RECVMMSG
+    if (collector->udp_batch) {
+        return (collector->udp_batch->next < collector->udp_batch->fill);
+    }
+#endif
+    if (!collector->rbuf) {
+        return FALSE;
+    }
+
+    avail = collector->rbuf_end - collector->rbuf_off;
+    if (avail < 4) {
+        return FALSE;
+    }
+    hdr = collector->rbuf + collector->rbuf_off;
+    h_len = (hdr[2] << 8) | hdr[3];
+
+    return (avail >= h_len);
+}
+
+gboolean fbCollectorSetUDPBatch(
+    fbCollector_t *collector,
+    unsigned int   batch_size,
+    GError       **err)
+{
+#if HAVE_RECVMMSG
+    fbCollectorUDPBatch_t *batch = collector->udp_batch;
+    unsigned int           i;
+
+    if (collector->coread != fbCollectorReadUDP) {
+        g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_IMPL,
+                    "Batched reads are only supported on UDP collectors");
+        return FALSE;
+    }
+    if (batch_size > FB_COLLECTOR_UDP_BATCH_MAX) {
+        g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_IMPL,
+                    "UDP batch size %u exceeds maximum %u",
+                    batch_size, FB_COLLECTOR_UDP_BATCH_MAX);
+        return FALSE;
+    }
+    if (batch && batch->next != batch->fill) {
+        g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_IMPL,
+                    "Cannot resize UDP batch while datagrams are buffered");
+        return FALSE;
+    }
+
+    if (batch) {
+        fbCollectorUDPBatchFree(batch);
+        collector->udp_batch = NULL;
+    }
+    if (batch_size < 2) {
+        return TRUE;
+    }
+
+    batch = g_slice_new0(fbCollectorUDPBatch_t);
+    batch->size = batch_size;
+    batch->msgs = g_new0(struct mmsghdr, batch_size);
+    batch->iov = g_new0(struct iovec, batch_size);
+    batch->peers = g_malloc0(sizeof(*batch->peers) * batch_size);
+    batch->data = g_malloc((size_t)FB_COLLECTOR_UDP_SLOT_SIZE * batch_size);
+    for (i = 0; i < batch_size; i++) {
+        batch->iov[i].iov_base = batch->data + FB_COLLECTOR_UDP_SLOT_SIZE * i;
+        batch->iov[i].iov_len = FB_COLLECTOR_UDP_SLOT_SIZE;
+        batch->msgs[i].msg_hdr.msg_name = &batch->peers[i];
+        batch->msgs[i].msg_hdr.msg_iov = &batch->iov[i];
+        batch->msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+    collector->udp_batch = batch;
+
+    return TRUE;
+#else  /* HAVE_RECVMMSG */
+    if (batch_size < 2) {
+        return TRUE;
+    }
+    g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_IMPL,
+                "Batched UDP reads are not supported on this platform");
+    return FALSE;
+#endif  /* HAVE_RECVMMSG */
+}
+
+void fbCollectorGetUDPBatchStats(
+    fbCollector_t *collector,
+    uint64_t      *batches,
+    uint64_t      *datagrams,
+    uint64_t      *full_batches)
+{
+    uint64_t       b = 0, d = 0, f = 0;
+
+#if HAVE_RECVMMSG
+    if (collector->udp_batch) {
+        b = collector->udp_batch->batches;
+        d = collector->udp_batch->datagrams;
+        f = collector->udp_batch->full;
+    }
+#else
+    (void)collector;
+#endif
+    if (batches) {
+        *batches = b;
+    }
+    if (datagrams) {
+        *datagrams = d;
+    }
+    if (full_batches) {
+        *full_batches = f;
+    }
+}
@@ -49,6 +49,18 @@
 /* 30 mins in seconds */
 #define FB_UDP_TIMEOUT 1800
 
+/* size of the receive buffer for buffered TCP reads */
+#define FB_COLLECTOR_RBUF_SIZE (256 * 1024)
+
+/* maximum number of datagrams read by one batched UDP receive */
+#define FB_COLLECTOR_UDP_BATCH_MAX 1024
+
+/* size of each datagram slot for batched UDP reads */
+#define FB_COLLECTOR_UDP_SLOT_SIZE 65536
+
+/* batched UDP receive state; defined in fbcollector.c */
+typedef struct fbCollectorUDPBatch_st fbCollectorUDPBatch_t;
+
 
 /**
  * fbCollectorClose_fn
@@ -322,8 +334,49 @@ struct fbCollector_st {
     fbCollectorTransClose_fn    cotransClose;
     fbCollectorSessionTimeout_fn cotimeOut;
     void                        *translatorState;
+    /**
+     * UDP connection specs, most recently seen first, so the tail is the
+     * first to time out.
+     */
     fbUDPConnSpec_t             *udp_head;
     fbUDPConnSpec_t             *udp_tail;
+    /**
+     * The same UDP connection specs keyed by peer address and
+     * observation domain, or NULL before the first UDP message.
+     */
+    GHashTable                  *udp_hash;
+    /**
+     * Receive buffer of FB_COLLECTOR_RBUF_SIZE bytes for buffered TCP
+     * reads, or NULL when reads are unbuffered.  Bytes from rbuf_off up
+     * to rbuf_end have been read from the socket but not yet returned.
+     */
+    uint8_t                     *rbuf;
+    /** Offset of the first unconsumed byte in rbuf */
+    size_t                      rbuf_off;
+    /** Offset just past the last byte read into rbuf */
+    size_t                      rbuf_end;
+    /**
+     * Version and length of the next message, read ahead of the message
+     * by fbCollectMessageSize() on an unbuffered stream.  The read
+     * function returns them before reading the rest of the message.
+     */
+    fbCollectorMsgVL_t          vl_next;
+    /** TRUE when vl_next holds a header that has not yet been returned */
+    gboolean                    vl_pending;
+    /**
+     * Ring of datagram slots for batched UDP reads, or NULL when each
+     * datagram is read separately.
+     */
+    fbCollectorUDPBatch_t       *udp_batch;
+    /**
+     * Mapping of the file read by a collector from fbCollectorAllocMmap(),
+     * or NULL.  Messages are returned from map_off up to map_len.
+     */
+    uint8_t                     *map;
+    /** Length of map */
+    size_t                      map_len;
+    /** Offset in map of the next message */
+    size_t                      map_off;
 };
 
 #endif
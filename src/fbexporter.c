@@ -46,9 +46,17 @@
  * specified source interface for exported IPFIX flows.
  */
 
+#ifndef _GNU_SOURCE
+/* for sendmmsg() */
+#define _GNU_SOURCE
+#endif
 #define _FIXBUF_SOURCE_
 #include <fixbuf/private.h>
 #include <arpa/inet.h>
+#include <sys/uio.h>
+#include <sys/time.h>
+#include <pthread.h>
+#include <fcntl.h>
 
 
 /**
@@ -68,6 +76,122 @@
 #define V4_MAX_SOURCE_ENTRY_LENGTH 15
 #define V6_MAX_SOURCE_ENTRY_LENGTH 45
 
+/** Maximum number of messages in an exporter's batch queue */
+#define FB_EXPORTER_BATCH_MAX       1024
+
+/**
+ * Queue of completed messages waiting to be written together; see
+ * fbExporterSetBatch().  The messages are copied end-to-end into `data`,
+ * since the fBuf reuses its buffer as soon as fbExportMessage() returns.
+ */
+typedef struct fbExporterQueue_st {
+    /** Copies of the queued messages */
+    uint8_t                     *data;
+    /** Number of bytes used in data */
+    size_t                      len;
+    /** Number of bytes allocated for data */
+    size_t                      cap;
+    /**
+     * One vector per queued message.  The length is set as the message is
+     * queued, the base when the queue is flushed.
+     */
+    struct iovec                *iov;
+#if HAVE_SENDMMSG
+    /** Message headers for sendmmsg(), UDP only */
+    struct mmsghdr              *msgs;
+#endif
+    /** Number of queued messages */
+    unsigned int                count;
+    /** Number of queued messages that triggers a flush */
+    unsigned int                max;
+    /** Oldest queued message age that triggers a flush, in usec; 0 for none */
+    gint64                      delay;
+    /** Monotonic time at which the oldest queued message was queued */
+    gint64                      first;
+} fbExporterQueue_t;
+
+/** Maximum number of message buffers in an exporter's writer pipeline */
+#define FB_EXPORTER_PIPELINE_MAX    256
+
+/** A message buffer in an exporter's writer pipeline */
+typedef struct fbExporterSlot_st {
+    /** Copy of the message */
+    uint8_t                     *msg;
+    /** Length of the message */
+    size_t                      len;
+    /** Number of bytes allocated for msg */
+    size_t                      cap;
+} fbExporterSlot_t;
+
+/**
+ * Pipeline that hands completed messages to a writer thread; see
+ * fbExporterSetWriterThread().  The slots form a single-producer,
+ * single-consumer ring: the thread calling fbExportMessage() copies a
+ * message into the slot at `tail` and increments `fill`; the writer thread
+ * writes the slot at `head` and decrements `fill` once the write is done.
+ * The mutex and condition variable are only used by a side that has to
+ * sleep, which it announces through its `waiting` flag.  While the writer
+ * thread sleeps it also flushes the exporter's batch queue when its delay
+ * expires, so the application thread only touches the queue while holding
+ * the mutex.
+ */
+typedef struct fbExporterPipeline_st {
+    /** The message buffers */
+    fbExporterSlot_t            *slots;
+    /** Number of message buffers */
+    guint                       count;
+    /** Index of the next slot to write; owned by the writer thread */
+    guint                       head;
+    /** Index of the next slot to fill; owned by the producer */
+    guint                       tail;
+    /** Number of slots holding a message that is not yet written */
+    volatile gint               fill;
+    /** Set while the writer thread waits for a message */
+    volatile gint               writer_waiting;
+    /** Set while the producer waits for the writer thread */
+    volatile gint               producer_waiting;
+    /** Set to tell the writer thread to exit once the ring is empty */
+    gboolean                    stop;
+    /** Whether the producer waits when all slots are in use */
+    gboolean                    block;
+    /** First write error not yet reported to the producer */
+    GError                      *error;
+    /** Number of messages handed to the writer thread */
+    uint64_t                    messages;
+    /** Number of messages that found all slots in use */
+    uint64_t                    stalls;
+    /** The writer thread */
+    pthread_t                   thread;
+    /**
+     * Protects stop, error, and the batch queue while the writer thread
+     * sleeps, and is used with cond for sleeping
+     */
+    pthread_mutex_t             mutex;
+    /** Signaled when either side may have stopped waiting */
+    pthread_cond_t              cond;
+} fbExporterPipeline_t;
+
+/** Alignment of the block buffer and block size of a block file exporter */
+#define FB_EXPORTER_BLOCK_ALIGN     4096
+
+/**
+ * Write buffer of a file exporter in block mode; see
+ * fbExporterSetFileBlock().  Messages are packed into `buf`, which is
+ * written to the file descriptor in stream.fd each time it fills.
+ */
+typedef struct fbExporterBlock_st {
+    /** The block buffer, aligned to FB_EXPORTER_BLOCK_ALIGN */
+    uint8_t                     *buf;
+    /** Size of buf; a multiple of FB_EXPORTER_BLOCK_ALIGN */
+    size_t                      size;
+    /** Number of bytes used in buf */
+    size_t                      len;
+    /** Whether to open the file with O_DIRECT */
+    gboolean                    direct;
+    /** Number of bytes written to the current file */
+    uint64_t                    written;
+} fbExporterBlock_t;
+
 typedef gboolean    (*fbExporterOpen_fn)(
     fbExporter_t                *exporter,
     GError                      **err);
@@ -118,6 +242,16 @@ struct fbExporter_st {
     fbExporterWrite_fn          exwrite;
     fbExporterClose_fn          exclose;
     uint16_t                    mtu;
+    /** Messages waiting for a batched write, or NULL if not batching */
+    fbExporterQueue_t           *queue;
+    /** Writer thread pipeline, or NULL if messages are written inline */
+    fbExporterPipeline_t        *pipeline;
+    /** Block buffer of a file exporter in block mode, or NULL */
+    fbExporterBlock_t           *block;
+    /** Sync policy callback for block mode, or NULL */
+    fbExporterFileSync_fn       sync_fn;
+    /** Application context passed to sync_fn */
+    void                        *sync_ctx;
     char                        source_ip[V4_MAX_SOURCE_ENTRY_LENGTH + 1];
     char                        source_ip6[V6_MAX_SOURCE_ENTRY_LENGTH + 1];
 };
@@ -246,6 +380,277 @@ fbExporter_t    *fbExporterAllocFile(
     return exporter;
 }
 
+/**
+ * fbExporterOpenFileBlock
+ *
+ * Opens the file of a block mode file exporter with open(2), adding
+ * O_DIRECT if requested.
+ *
+ * @param exporter
+ * @param err
+ *
+ * @return
+ */
+static gboolean fbExporterOpenFileBlock(
+    fbExporter_t                *exporter,
+    GError                      **err)
+{
+    int                         flags = O_WRONLY | O_CREAT | O_TRUNC;
+
+    /* check to see if we're opening stdout */
+    if ((strlen(exporter->spec.path) == 1) &&
+        (exporter->spec.path[0] == '-'))
+    {
+        /* don't open a terminal */
+        if (isatty(STDOUT_FILENO)) {
+            g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_IO,
+                        "Refusing to open stdout terminal for export");
+            return FALSE;
+        }
+        exporter->stream.fd = STDOUT_FILENO;
+    } else {
+#ifdef O_DIRECT
+        if (exporter->block->direct) {
+            flags |= O_DIRECT;
+        }
+#endif
+        exporter->stream.fd = open(exporter->spec.path, flags, 0666);
+        if (exporter->stream.fd < 0) {
+            g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_IO,
+                        "Couldn't open %s for export: %s",
+                        exporter->spec.path, strerror(errno));
+            return FALSE;
+        }
+    }
+
+    exporter->block->len = 0;
+    exporter->block->written = 0;
+
+    /* set active flag */
+    exporter->active = TRUE;
+
+    return TRUE;
+}
+
+/**
+ * fbExporterFileBlockFlush
+ *
+ * Writes the used part of the block buffer to the file, then lets the
+ * sync policy callback decide whether to fsync().  A final block that is
+ * not a multiple of the alignment is written with O_DIRECT turned off.
+ *
+ * @param exporter
+ * @param closing   TRUE if the file is about to be closed
+ * @param err
+ *
+ * @return
+ */
+static gboolean fbExporterFileBlockFlush(
+    fbExporter_t                *exporter,
+    gboolean                    closing,
+    GError                      **err)
+{
+    fbExporterBlock_t           *block = exporter->block;
+    size_t                      off = 0;
+    ssize_t                     rc;
+
+#ifdef O_DIRECT
+    if (block->direct && (block->len % FB_EXPORTER_BLOCK_ALIGN)) {
+        int flags = fcntl(exporter->stream.fd, F_GETFL);
+        if (flags != -1 && (flags & O_DIRECT)) {
+            fcntl(exporter->stream.fd, F_SETFL, flags & ~O_DIRECT);
+        }
+    }
+#endif
+
+    while (off < block->len) {
+        rc = write(exporter->stream.fd, block->buf + off, block->len - off);
+        if (rc == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_IO,
+                        "Couldn't write %u bytes to %s: %s",
+                        (uint32_t)(block->len - off), exporter->spec.path,
+                        strerror(errno));
+            block->len = 0;
+            return FALSE;
+        }
+        off += rc;
+    }
+    block->written += block->len;
+    block->len = 0;
+
+    if (exporter->sync_fn &&
+        exporter->sync_fn(exporter, block->written, closing,
+                          exporter->sync_ctx) &&
+        fsync(exporter->stream.fd) != 0)
+    {
+        g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_IO,
+                    "Couldn't sync %s: %s",
+                    exporter->spec.path, strerror(errno));
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+/**
+ * fbExporterWriteFileBlock
+ *
+ * @param exporter
+ * @param msgbase
+ * @param msglen
+ * @param err
+ *
+ * @return
+ */
+static gboolean fbExporterWriteFileBlock(
+    fbExporter_t                *exporter,
+    uint8_t                     *msgbase,
+    size_t                      msglen,
+    GError                      **err)
+{
+    fbExporterBlock_t           *block = exporter->block;
+    size_t                      n;
+
+    /* messages may span blocks; only full blocks are written */
+    while (msglen) {
+        n = MIN(msglen, block->size - block->len);
+        memcpy(block->buf + block->len, msgbase, n);
+        block->len += n;
+        msgbase += n;
+        msglen -= n;
+        if (block->len == block->size &&
+            !fbExporterFileBlockFlush(exporter, FALSE, err))
+        {
+            return FALSE;
+        }
+    }
+    return TRUE;
+}
+
+/**
+ * fbExporterCloseFileBlock
+ *
+ * @param exporter
+ *
+ */
+static void fbExporterCloseFileBlock(
+    fbExporter_t                *exporter)
+{
+    GError                      *err = NULL;
+
+    if (!fbExporterFileBlockFlush(exporter, TRUE, &err)) {
+        g_warning("%s", err->message);
+        g_clear_error(&err);
+    }
+    if (exporter->stream.fd != STDOUT_FILENO) {
+        close(exporter->stream.fd);
+    }
+    exporter->stream.fd = -1;
+    exporter->active = FALSE;
+}
+
+/**
+ * fbExporterSetFileBlock
+ *
+ * @param exporter
+ * @param block_size
+ * @param direct
+ * @param err
+ *
+ * @return
+ */
+gboolean fbExporterSetFileBlock(
+    fbExporter_t                *exporter,
+    size_t                      block_size,
+    gboolean                    direct,
+    GError                      **err)
+{
+    fbExporterBlock_t           *block;
+    void                        *buf;
+
+    if (exporter->exopen != fbExporterOpenFile &&
+        exporter->exopen != fbExporterOpenFileBlock)
+    {
+        g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_IMPL,
+                    "Block mode requires an exporter from "
+                    "fbExporterAllocFile()");
+        return FALSE;
+    }
+    if (exporter->active) {
+        g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_IMPL,
+                    "Cannot change block mode while %s is open",
+                    exporter->spec.path);
+        return FALSE;
+    }
+    if (exporter->queue && block_size) {
+        g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_IMPL,
+                    "Block mode cannot be combined with batched export");
+        return FALSE;
+    }
+#ifndef O_DIRECT
+    if (direct) {
+        g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_IMPL,
+                    "O_DIRECT is not supported on this platform");
+        return FALSE;
+    }
+#endif
+
+    if (exporter->block) {
+        free(exporter->block->buf);
+        g_slice_free(fbExporterBlock_t, exporter->block);
+        exporter->block = NULL;
+    }
+
+    if (0 == block_size) {
+        exporter->exopen = fbExporterOpenFile;
+        exporter->exwrite = fbExporterWriteFile;
+        exporter->exclose = fbExporterCloseFile;
+        return TRUE;
+    }
+
+    /* round up to a whole number of aligned blocks */
+    block_size = ((block_size + FB_EXPORTER_BLOCK_ALIGN - 1)
+                  / FB_EXPORTER_BLOCK_ALIGN) * FB_EXPORTER_BLOCK_ALIGN;
+    if (posix_memalign(&buf, FB_EXPORTER_BLOCK_ALIGN, block_size) != 0) {
+        g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_IO,
+                    "Couldn't allocate %lu byte export block",
+                    (unsigned long)block_size);
+        return FALSE;
+    }
+
+    block = g_slice_new0(fbExporterBlock_t);
+    block->buf = (uint8_t *)buf;
+    block->size = block_size;
+    block->direct = direct;
+    exporter->block = block;
+
+    exporter->exopen = fbExporterOpenFileBlock;
+    exporter->exwrite = fbExporterWriteFileBlock;
+    exporter->exclose = fbExporterCloseFileBlock;
+
+    return TRUE;
+}
+
+/**
+ * fbExporterSetFileSync
+ *
+ * @param exporter
+ * @param sync_fn
+ * @param ctx
+ *
+ */
+void fbExporterSetFileSync(
+    fbExporter_t                *exporter,
+    fbExporterFileSync_fn       sync_fn,
+    void                        *ctx)
+{
+    exporter->sync_fn = sync_fn;
+    exporter->sync_ctx = ctx;
+}
+
 /**
  * fbExporterOpenBuffer
  *
@@ -273,6 +678,7 @@ static void fbExporterCloseBuffer(
     fbExporter_t              *exporter)
 {
     exporter->active = FALSE;
+    exporter->msg_len = 0;
 }
 
 static gboolean fbExporterWriteBuffer(
@@ -1411,8 +1817,176 @@ void fbExporterSetPRTTL(
 #endif  /* 0 */
 
 /**
- *fbExportMessage
+ * fbExporterQueueFree
+ *
+ * @param queue
+ *
+ */
+static void fbExporterQueueFree(
+    fbExporterQueue_t   *queue)
+{
+    if (NULL == queue) {
+        return;
+    }
+    g_free(queue->data);
+    g_free(queue->iov);
+#if HAVE_SENDMMSG
+    g_free(queue->msgs);
+#endif
+    g_slice_free(fbExporterQueue_t, queue);
+}
+
+#if HAVE_SENDMMSG
+/**
+ * fbExporterQueueSendUDP
  *
+ * Sends the queued messages as datagrams using as few sendmmsg() calls as
+ * possible.  If sendmmsg() fails, the remaining messages are handed to
+ * fbExporterWriteUDP() one at a time so the error is handled exactly as
+ * it is without batching.
+ *
+ * @param exporter
+ * @param err
+ *
+ * @return
+ */
+static gboolean fbExporterQueueSendUDP(
+    fbExporter_t        *exporter,
+    GError              **err)
+{
+    fbExporterQueue_t   *queue = exporter->queue;
+    unsigned int        sent = 0;
+    unsigned int        i;
+    int                 rc;
+
+    for (i = 0; i < queue->count; ++i) {
+        memset(&queue->msgs[i], 0, sizeof(queue->msgs[i]));
+        queue->msgs[i].msg_hdr.msg_iov = &queue->iov[i];
+        queue->msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    while (sent < queue->count) {
+        rc = sendmmsg(exporter->stream.fd, queue->msgs + sent,
+                      queue->count - sent, 0);
+        if (rc == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        for (i = sent; i < sent + (unsigned int)rc; ++i) {
+            if (queue->msgs[i].msg_len != queue->iov[i].iov_len) {
+                g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_IO,
+                            "Short write on UDP send: wrote %u while "
+                            "writing %u", queue->msgs[i].msg_len,
+                            (uint32_t)queue->iov[i].iov_len);
+                return FALSE;
+            }
+        }
+        sent += rc;
+    }
+
+    for (; sent < queue->count; ++sent) {
+        if (!fbExporterWriteUDP(exporter, queue->iov[sent].iov_base,
+                                queue->iov[sent].iov_len, err))
+        {
+            return FALSE;
+        }
+    }
+    return TRUE;
+}
+#endif  /* HAVE_SENDMMSG */
+
+/**
+ * fbExporterQueueWriteTCP
+ *
+ * Writes the queued messages, which are contiguous in the queue, to the
+ * TCP socket, continuing after partial writes.
+ *
+ * @param exporter
+ * @param err
+ *
+ * @return
+ */
+static gboolean fbExporterQueueWriteTCP(
+    fbExporter_t        *exporter,
+    GError              **err)
+{
+    fbExporterQueue_t   *queue = exporter->queue;
+    size_t              off = 0;
+    ssize_t             rc;
+
+    while (off < queue->len) {
+        rc = write(exporter->stream.fd, queue->data + off, queue->len - off);
+        if (rc == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EPIPE) {
+                g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_NLWRITE,
+                            "Connection reset (EPIPE) on TCP write");
+            } else {
+                g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_IO,
+                            "I/O error: %s", strerror(errno));
+            }
+            return FALSE;
+        }
+        off += rc;
+    }
+    return TRUE;
+}
+
+/**
+ * fbExporterQueueFlush
+ *
+ * Writes all queued messages and empties the queue, whether or not the
+ * write succeeds.  Does nothing when the exporter is not batching.
+ *
+ * @param exporter
+ * @param err
+ *
+ * @return
+ */
+static gboolean fbExporterQueueFlush(
+    fbExporter_t        *exporter,
+    GError              **err)
+{
+    fbExporterQueue_t   *queue = exporter->queue;
+    uint8_t             *base;
+    gboolean            ok;
+    unsigned int        i;
+
+    if (NULL == queue || 0 == queue->count) {
+        return TRUE;
+    }
+
+    base = queue->data;
+    for (i = 0; i < queue->count; ++i) {
+        queue->iov[i].iov_base = base;
+        base += queue->iov[i].iov_len;
+    }
+
+#if HAVE_SENDMMSG
+    if (exporter->exwrite == fbExporterWriteUDP) {
+        ok = fbExporterQueueSendUDP(exporter, err);
+    } else
+#endif
+    if (exporter->exwrite == fbExporterWriteTCP) {
+        ok = fbExporterQueueWriteTCP(exporter, err);
+    } else {
+        ok = exporter->exwrite(exporter, queue->data, queue->len, err);
+    }
+
+    queue->count = 0;
+    queue->len = 0;
+    return ok;
+}
+
+/**
+ * fbExporterQueueMessage
+ *
+ * Copies a message to the end of the queue and flushes the queue if it is
+ * full or its oldest message has waited longer than the flush delay.
  *
  * @param exporter
  * @param msgbase
@@ -1420,9 +1994,156 @@ void fbExporterSetPRTTL(
  * @param err
  *
  * @return
+ */
+static gboolean fbExporterQueueMessage(
+    fbExporter_t        *exporter,
+    uint8_t             *msgbase,
+    size_t              msglen,
+    GError              **err)
+{
+    fbExporterQueue_t   *queue = exporter->queue;
+    gint64              now = 0;
+
+    if (queue->delay) {
+        now = g_get_monotonic_time();
+        if (0 == queue->count) {
+            queue->first = now;
+        }
+    }
+
+    if (queue->len + msglen > queue->cap) {
+        queue->cap = MAX(queue->cap * 2, queue->len + msglen);
+        queue->data = g_realloc(queue->data, queue->cap);
+    }
+    memcpy(queue->data + queue->len, msgbase, msglen);
+    queue->len += msglen;
+    queue->iov[queue->count].iov_len = msglen;
+    ++queue->count;
+
+    if (queue->count >= queue->max
+        || (queue->delay && now - queue->first >= queue->delay))
+    {
+        return fbExporterQueueFlush(exporter, err);
+    }
+    return TRUE;
+}
+
+/**
+ * fbExporterSetBatch
  *
+ * @param exporter
+ * @param max_messages
+ * @param max_delay_ms
+ * @param err
+ *
+ * @return
  */
-gboolean        fbExportMessage(
+gboolean fbExporterSetBatch(
+    fbExporter_t        *exporter,
+    unsigned int        max_messages,
+    unsigned int        max_delay_ms,
+    GError              **err)
+{
+    fbExporterQueue_t   *queue;
+
+    if (exporter->exwrite != fbExporterWriteUDP &&
+        exporter->exwrite != fbExporterWriteTCP &&
+        exporter->exwrite != fbExporterWriteFile)
+    {
+        g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_IMPL,
+                    "Batched export requires a UDP, TCP, or file exporter");
+        return FALSE;
+    }
+    if (max_messages > FB_EXPORTER_BATCH_MAX) {
+        g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_IMPL,
+                    "Export batch size %u exceeds maximum %u",
+                    max_messages, FB_EXPORTER_BATCH_MAX);
+        return FALSE;
+    }
+#if !HAVE_SENDMMSG
+    if (max_messages > 1 && exporter->exwrite == fbExporterWriteUDP) {
+        g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_IMPL,
+                    "Batched UDP export requires sendmmsg()");
+        return FALSE;
+    }
+#endif
+
+    /* Write the messages queued under the previous setting */
+    if (!fbExporterFlush(exporter, err)) {
+        return FALSE;
+    }
+
+    queue = NULL;
+    if (max_messages >= 2) {
+        queue = g_slice_new0(fbExporterQueue_t);
+        queue->max = max_messages;
+        queue->delay = (gint64)max_delay_ms * 1000;
+        queue->cap = (size_t)exporter->mtu * MIN(max_messages, 16);
+        queue->data = g_malloc(queue->cap);
+        queue->iov = g_new0(struct iovec, max_messages);
+#if HAVE_SENDMMSG
+        if (exporter->exwrite == fbExporterWriteUDP) {
+            queue->msgs = g_new0(struct mmsghdr, max_messages);
+        }
+#endif
+    }
+
+    /* A sleeping writer thread looks at the queue */
+    if (exporter->pipeline) {
+        pthread_mutex_lock(&exporter->pipeline->mutex);
+    }
+    fbExporterQueueFree(exporter->queue);
+    exporter->queue = queue;
+    if (exporter->pipeline) {
+        pthread_mutex_unlock(&exporter->pipeline->mutex);
+    }
+
+    return TRUE;
+}
+
+/**
+ * fbExporterGetFlushTimeout
+ *
+ * @param exporter
+ *
+ * @return
+ */
+int fbExporterGetFlushTimeout(
+    fbExporter_t        *exporter)
+{
+    fbExporterQueue_t   *queue = exporter->queue;
+    gint64              wait;
+
+    /* A writer thread flushes the queue itself */
+    if (exporter->pipeline || NULL == queue || 0 == queue->count ||
+        0 == queue->delay)
+    {
+        return -1;
+    }
+
+    wait = queue->first + queue->delay - g_get_monotonic_time();
+    if (wait <= 0) {
+        return 0;
+    }
+    /* round up so that a wait of this length reaches the deadline */
+    return (int)((wait + 999) / 1000);
+}
+
+/**
+ * fbExporterWriteMessage
+ *
+ * Writes a message to the exporter's stream, opening the stream if
+ * needed, or adds it to the batch queue.  Closes the stream on failure.
+ * Called by the writer thread when the exporter has one.
+ *
+ * @param exporter
+ * @param msgbase
+ * @param msglen
+ * @param err
+ *
+ * @return
+ */
+static gboolean fbExporterWriteMessage(
     fbExporter_t    *exporter,
     uint8_t         *msgbase,
     size_t          msglen,
@@ -1434,14 +2155,430 @@ gboolean        fbExportMessage(
         if (!exporter->exopen(exporter, err)) return FALSE;
     }
 
-    /* Attempt to write message */
-    if (exporter->exwrite(exporter, msgbase, msglen, err)) return TRUE;
+    /* Attempt to write message, or add it to the batch */
+    if (exporter->queue) {
+        if (fbExporterQueueMessage(exporter, msgbase, msglen, err)) {
+            return TRUE;
+        }
+    } else if (exporter->exwrite(exporter, msgbase, msglen, err)) {
+        return TRUE;
+    }
 
     /* Close exporter on write failure */
     if (exporter->exclose) exporter->exclose(exporter);
     return FALSE;
 }
 
+/**
+ * fbExporterPipelineWait
+ *
+ * Waits until no more than `limit` messages are waiting for the writer
+ * thread.
+ *
+ * @param pipeline
+ * @param limit
+ *
+ */
+static void fbExporterPipelineWait(
+    fbExporterPipeline_t    *pipeline,
+    guint                   limit)
+{
+    if ((guint)g_atomic_int_get(&pipeline->fill) <= limit) {
+        return;
+    }
+    pthread_mutex_lock(&pipeline->mutex);
+    g_atomic_int_set(&pipeline->producer_waiting, 1);
+    while ((guint)g_atomic_int_get(&pipeline->fill) > limit) {
+        pthread_cond_wait(&pipeline->cond, &pipeline->mutex);
+    }
+    g_atomic_int_set(&pipeline->producer_waiting, 0);
+    pthread_mutex_unlock(&pipeline->mutex);
+}
+
+/**
+ * fbExporterPipelineError
+ *
+ * Moves a write error reported by the writer thread to `err`.
+ *
+ * @param pipeline
+ * @param err
+ *
+ * @return FALSE if there was an error to report
+ */
+static gboolean fbExporterPipelineError(
+    fbExporterPipeline_t    *pipeline,
+    GError                  **err)
+{
+    if (NULL == g_atomic_pointer_get(&pipeline->error)) {
+        return TRUE;
+    }
+    pthread_mutex_lock(&pipeline->mutex);
+    g_propagate_error(err, pipeline->error);
+    g_atomic_pointer_set(&pipeline->error, NULL);
+    pthread_mutex_unlock(&pipeline->mutex);
+    return FALSE;
+}
+
+/**
+ * fbExporterWriterSleep
+ *
+ * Called by the writer thread, with the pipeline mutex held, when no
+ * message is waiting.  Sleeps until signaled or until the oldest batched
+ * message has waited for the batch delay, and writes the batch once it
+ * has.
+ *
+ * @param exporter
+ *
+ */
+static void fbExporterWriterSleep(
+    fbExporter_t            *exporter)
+{
+    fbExporterPipeline_t    *pipeline = exporter->pipeline;
+    fbExporterQueue_t       *queue = exporter->queue;
+    GError                  *err = NULL;
+    struct timeval          now;
+    struct timespec         deadline;
+    gint64                  wait;
+
+    if (NULL == queue || 0 == queue->count || 0 == queue->delay) {
+        pthread_cond_wait(&pipeline->cond, &pipeline->mutex);
+        return;
+    }
+
+    wait = queue->first + queue->delay - g_get_monotonic_time();
+    if (wait > 0) {
+        /* the condition variable times out against the real-time clock */
+        gettimeofday(&now, NULL);
+        wait += now.tv_usec;
+        deadline.tv_sec = now.tv_sec + wait / 1000000;
+        deadline.tv_nsec = (wait % 1000000) * 1000;
+        pthread_cond_timedwait(&pipeline->cond, &pipeline->mutex, &deadline);
+        return;
+    }
+
+    if (!fbExporterQueueFlush(exporter, &err)) {
+        /* Close exporter on write failure */
+        if (exporter->exclose) exporter->exclose(exporter);
+        if (NULL == pipeline->error) {
+            g_atomic_pointer_set(&pipeline->error, err);
+        } else {
+            g_clear_error(&err);
+        }
+    }
+}
+
+/**
+ * fbExporterWriterMain
+ *
+ * Writer thread: writes the messages in the pipeline ring in order until
+ * told to stop.
+ *
+ * @param arg  the exporter
+ *
+ * @return NULL
+ */
+static void *fbExporterWriterMain(
+    void                    *arg)
+{
+    fbExporter_t            *exporter = (fbExporter_t *)arg;
+    fbExporterPipeline_t    *pipeline = exporter->pipeline;
+    fbExporterSlot_t        *slot;
+    GError                  *err = NULL;
+    gboolean                stop;
+
+    for (;;) {
+        if (0 == g_atomic_int_get(&pipeline->fill)) {
+            pthread_mutex_lock(&pipeline->mutex);
+            g_atomic_int_set(&pipeline->writer_waiting, 1);
+            while (0 == g_atomic_int_get(&pipeline->fill) && !pipeline->stop) {
+                fbExporterWriterSleep(exporter);
+            }
+            g_atomic_int_set(&pipeline->writer_waiting, 0);
+            stop = (pipeline->stop && 0 == g_atomic_int_get(&pipeline->fill));
+            pthread_mutex_unlock(&pipeline->mutex);
+            if (stop) {
+                break;
+            }
+            continue;
+        }
+
+        slot = &pipeline->slots[pipeline->head];
+        if (!fbExporterWriteMessage(exporter, slot->msg, slot->len, &err)) {
+            /* keep the first error until the producer collects it */
+            pthread_mutex_lock(&pipeline->mutex);
+            if (NULL == pipeline->error) {
+                g_atomic_pointer_set(&pipeline->error, err);
+            } else {
+                g_clear_error(&err);
+            }
+            pthread_mutex_unlock(&pipeline->mutex);
+            err = NULL;
+        }
+        pipeline->head = (pipeline->head + 1) % pipeline->count;
+
+        /* release the slot, then wake the producer if it is waiting */
+        g_atomic_int_add(&pipeline->fill, -1);
+        if (g_atomic_int_get(&pipeline->producer_waiting)) {
+            pthread_mutex_lock(&pipeline->mutex);
+            pthread_cond_broadcast(&pipeline->cond);
+            pthread_mutex_unlock(&pipeline->mutex);
+        }
+    }
+    return NULL;
+}
+
+/**
+ * fbExporterPipelinePush
+ *
+ * Copies a message into the next free slot of the pipeline ring and wakes
+ * the writer thread.
+ *
+ * @param exporter
+ * @param msgbase
+ * @param msglen
+ * @param err
+ *
+ * @return
+ */
+static gboolean fbExporterPipelinePush(
+    fbExporter_t            *exporter,
+    uint8_t                 *msgbase,
+    size_t                  msglen,
+    GError                  **err)
+{
+    fbExporterPipeline_t    *pipeline = exporter->pipeline;
+    fbExporterSlot_t        *slot;
+
+    /* Report a failure to write an earlier message */
+    if (!fbExporterPipelineError(pipeline, err)) {
+        return FALSE;
+    }
+
+    if ((guint)g_atomic_int_get(&pipeline->fill) == pipeline->count) {
+        ++pipeline->stalls;
+        if (!pipeline->block) {
+            g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_BUSY,
+                        "All %u export pipeline buffers are in use",
+                        pipeline->count);
+            return FALSE;
+        }
+        fbExporterPipelineWait(pipeline, pipeline->count - 1);
+    }
+
+    slot = &pipeline->slots[pipeline->tail];
+    if (msglen > slot->cap) {
+        slot->msg = g_realloc(slot->msg, msglen);
+        slot->cap = msglen;
+    }
+    memcpy(slot->msg, msgbase, msglen);
+    slot->len = msglen;
+    pipeline->tail = (pipeline->tail + 1) % pipeline->count;
+    ++pipeline->messages;
+
+    /* publish the slot, then wake the writer if it is waiting */
+    g_atomic_int_inc(&pipeline->fill);
+    if (g_atomic_int_get(&pipeline->writer_waiting)) {
+        pthread_mutex_lock(&pipeline->mutex);
+        pthread_cond_broadcast(&pipeline->cond);
+        pthread_mutex_unlock(&pipeline->mutex);
+    }
+    return TRUE;
+}
+
+/**
+ * fbExporterPipelineFree
+ *
+ * Waits for the writer thread to write all pending messages, stops it,
+ * and frees the pipeline.  Moves any unreported write error to `err`.
+ *
+ * @param exporter
+ * @param err
+ *
+ * @return FALSE if there was an error to report
+ */
+static gboolean fbExporterPipelineFree(
+    fbExporter_t            *exporter,
+    GError                  **err)
+{
+    fbExporterPipeline_t    *pipeline = exporter->pipeline;
+    gboolean                ok;
+    guint                   i;
+
+    if (NULL == pipeline) {
+        return TRUE;
+    }
+
+    pthread_mutex_lock(&pipeline->mutex);
+    pipeline->stop = TRUE;
+    pthread_cond_broadcast(&pipeline->cond);
+    pthread_mutex_unlock(&pipeline->mutex);
+    pthread_join(pipeline->thread, NULL);
+
+    ok = fbExporterPipelineError(pipeline, err);
+
+    pthread_cond_destroy(&pipeline->cond);
+    pthread_mutex_destroy(&pipeline->mutex);
+    for (i = 0; i < pipeline->count; ++i) {
+        g_free(pipeline->slots[i].msg);
+    }
+    g_free(pipeline->slots);
+    g_slice_free(fbExporterPipeline_t, pipeline);
+    exporter->pipeline = NULL;
+
+    return ok;
+}
+
+/**
+ * fbExporterSetWriterThread
+ *
+ * @param exporter
+ * @param buffers
+ * @param block
+ * @param err
+ *
+ * @return
+ */
+gboolean fbExporterSetWriterThread(
+    fbExporter_t            *exporter,
+    unsigned int            buffers,
+    gboolean                block,
+    GError                  **err)
+{
+    fbExporterPipeline_t    *pipeline;
+    guint                   i;
+    int                     rc;
+
+    if (exporter->exwrite == fbExporterWriteBuffer) {
+        g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_IMPL,
+                    "A buffer exporter cannot use a writer thread");
+        return FALSE;
+    }
+    if (buffers > FB_EXPORTER_PIPELINE_MAX) {
+        g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_IMPL,
+                    "Export pipeline size %u exceeds maximum %u",
+                    buffers, FB_EXPORTER_PIPELINE_MAX);
+        return FALSE;
+    }
+
+    /* Stop the current writer thread once it has written everything */
+    if (!fbExporterPipelineFree(exporter, err)) {
+        return FALSE;
+    }
+    if (0 == buffers) {
+        return TRUE;
+    }
+
+    pipeline = g_slice_new0(fbExporterPipeline_t);
+    pipeline->count = buffers;
+    pipeline->block = block;
+    pipeline->slots = g_new0(fbExporterSlot_t, buffers);
+    for (i = 0; i < buffers; ++i) {
+        pipeline->slots[i].cap = exporter->mtu;
+        pipeline->slots[i].msg = g_malloc(exporter->mtu);
+    }
+    pthread_mutex_init(&pipeline->mutex, NULL);
+    pthread_cond_init(&pipeline->cond, NULL);
+    exporter->pipeline = pipeline;
+
+    rc = pthread_create(&pipeline->thread, NULL, fbExporterWriterMain,
+                        exporter);
+    if (rc != 0) {
+        g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_IO,
+                    "Unable to create writer thread: %s", strerror(rc));
+        pthread_cond_destroy(&pipeline->cond);
+        pthread_mutex_destroy(&pipeline->mutex);
+        for (i = 0; i < buffers; ++i) {
+            g_free(pipeline->slots[i].msg);
+        }
+        g_free(pipeline->slots);
+        g_slice_free(fbExporterPipeline_t, pipeline);
+        exporter->pipeline = NULL;
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+/**
+ * fbExporterGetWriterStats
+ *
+ * @param exporter
+ * @param messages
+ * @param stalls
+ *
+ */
+void fbExporterGetWriterStats(
+    fbExporter_t        *exporter,
+    uint64_t            *messages,
+    uint64_t            *stalls)
+{
+    if (messages) {
+        *messages = exporter->pipeline ? exporter->pipeline->messages : 0;
+    }
+    if (stalls) {
+        *stalls = exporter->pipeline ? exporter->pipeline->stalls : 0;
+    }
+}
+
+/**
+ * fbExporterFlush
+ *
+ * @param exporter
+ * @param err
+ *
+ * @return
+ */
+gboolean fbExporterFlush(
+    fbExporter_t        *exporter,
+    GError              **err)
+{
+    gboolean            ok;
+
+    if (exporter->pipeline) {
+        fbExporterPipelineWait(exporter->pipeline, 0);
+        if (!fbExporterPipelineError(exporter->pipeline, err)) {
+            return FALSE;
+        }
+        /* A sleeping writer thread may flush the queue itself */
+        pthread_mutex_lock(&exporter->pipeline->mutex);
+    }
+
+    ok = fbExporterQueueFlush(exporter, err);
+
+    /* Close exporter on write failure */
+    if (!ok && exporter->exclose) exporter->exclose(exporter);
+
+    if (exporter->pipeline) {
+        pthread_mutex_unlock(&exporter->pipeline->mutex);
+    }
+    return ok;
+}
+
+/**
+ *fbExportMessage
+ *
+ *
+ * @param exporter
+ * @param msgbase
+ * @param msglen
+ * @param err
+ *
+ * @return
+ *
+ */
+gboolean        fbExportMessage(
+    fbExporter_t    *exporter,
+    uint8_t         *msgbase,
+    size_t          msglen,
+    GError          **err)
+{
+    /* Hand the message to the writer thread if there is one */
+    if (exporter->pipeline) {
+        return fbExporterPipelinePush(exporter, msgbase, msglen, err);
+    }
+    return fbExporterWriteMessage(exporter, msgbase, msglen, err);
+}
+
 /**
  *fbExporterFree
  *
@@ -1453,7 +2590,14 @@ void                fbExporterFree(
     fbExporter_t       *exporter)
 {
     fbExporterClose(exporter);
-    if (exporter->exwrite == fbExporterWriteFile)
+    fbExporterPipelineFree(exporter, NULL);
+    fbExporterQueueFree(exporter->queue);
+    if (exporter->block) {
+        free(exporter->block->buf);
+        g_slice_free(fbExporterBlock_t, exporter->block);
+    }
+    if (exporter->exwrite == fbExporterWriteFile ||
+        exporter->exwrite == fbExporterWriteFileBlock)
     {
         g_free(exporter->spec.path);
     }
@@ -1480,7 +2624,20 @@ void                fbExporterFree(
 void fbExporterClose(
     fbExporter_t    *exporter)
 {
-    if (exporter->active && exporter->exclose) exporter->exclose(exporter);
+    /* Let the writer thread finish the messages it has; it may still
+     * flush the queue while it sleeps */
+    if (exporter->pipeline) {
+        fbExporterPipelineWait(exporter->pipeline, 0);
+        pthread_mutex_lock(&exporter->pipeline->mutex);
+    }
+    if (exporter->active) {
+        /* Write any batched messages before closing */
+        fbExporterQueueFlush(exporter, NULL);
+        if (exporter->exclose) exporter->exclose(exporter);
+    }
+    if (exporter->pipeline) {
+        pthread_mutex_unlock(&exporter->pipeline->mutex);
+    }
 }
 
 /**
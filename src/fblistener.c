@@ -42,6 +42,9 @@
 #define _FIXBUF_SOURCE_
 #include <fixbuf/private.h>
 #include <poll.h>
+#if HAVE_SYS_EPOLL_H
+#include <sys/epoll.h>
+#endif
 
 
 
@@ -88,6 +91,40 @@
 /* Maximum number of connections allowed by fixbuf */
 #define MAX_CONNECTIONS 25
 
+#if HAVE_SYS_EPOLL_H
+/* Maximum number of events read by one epoll_wait() */
+#define FB_LISTENER_EPOLL_EVENTS 64
+
+/**
+ * A file descriptor registered with a listener's epoll instance; the
+ * event data of the registration points to it.  Since readiness is
+ * level-triggered, an entry leaves the listener's ready queue when it is
+ * returned, and epoll reports it again while input remains.  A collector
+ * with a complete buffered message also queues its entry.
+ */
+typedef struct fbListenerEvent_st {
+    /** Next entry on the ready queue */
+    struct fbListenerEvent_st   *next;
+    /** Previous entry on the ready queue */
+    struct fbListenerEvent_st   *prev;
+    /** Listener that owns this entry */
+    fbListener_t                *listener;
+    /** Collection buffer of a connection; NULL for passive sockets */
+    fBuf_t                      *fbuf;
+    /** The registered file descriptor */
+    int                         fd;
+    /** TRUE for the read end of the interrupt pipe */
+    gboolean                    interrupt;
+    /** TRUE when the entry is on the ready queue */
+    gboolean                    queued;
+    /**
+     * TRUE when epoll reported input; FALSE when the entry was queued only
+     * for a buffered message, which is checked again before it is returned
+     */
+    gboolean                    input;
+} fbListenerEvent_t;
+#endif  /* HAVE_SYS_EPOLL_H */
+
 struct fbListener_st {
     /** Connection specifier for passive socket. */
     fbConnSpec_t                *spec;
@@ -127,6 +164,11 @@ struct fbListener_st {
      * Maps file descriptors to active listener-managed buffer instances.
      */
     GHashTable                  *fdtab;
+    /**
+     * Set of the file descriptors in fdtab whose collectors may hold a
+     * complete buffered message; see fbListenerQueueBufferedMessage().
+     */
+    GHashTable                  *buffered;
     /**
      * Application initialization function. Allows the application
      * to bind internal context to a collector, and to reject connections
@@ -135,6 +177,21 @@ struct fbListener_st {
     fbListenerAppInit_fn        appinit;
     /** Application free function. Frees storage allocated by appinit. */
     fbListenerAppFree_fn        appfree;
+    /**
+     * TRUE if the passive sockets are bound with SO_REUSEPORT, so that
+     * several listeners may share the same local endpoint.
+     */
+    gboolean                    reuseport;
+#if HAVE_SYS_EPOLL_H
+    /** epoll instance, or -1 when the listener waits with poll() */
+    int                         epfd;
+    /** Maps file descriptors to their fbListenerEvent_t */
+    GHashTable                  *eptab;
+    /** Head of the queue of entries that may have input */
+    fbListenerEvent_t           *ready_head;
+    /** Tail of the queue of entries that may have input */
+    fbListenerEvent_t           *ready_tail;
+#endif
 };
 
 typedef struct fbListenerWaitFDSet_st {
@@ -156,6 +213,10 @@ struct fbListenerGroup_st
     struct pollfd       *group_pfd;
     /** length of usable fds */
     nfds_t               pfd_len;
+#if HAVE_SYS_EPOLL_H
+    /** epoll instance watching the listeners' epoll instances, or -1 */
+    int                  epfd;
+#endif
 };
 
 
@@ -263,6 +324,16 @@ static gboolean fbListenerInitSocket(
         if (cpfd->fd < 0) {
             i++; continue;
         }
+#ifdef SO_REUSEPORT
+        if (listener->reuseport) {
+            int on = 1;
+            if (setsockopt(cpfd->fd, SOL_SOCKET, SO_REUSEPORT,
+                           &on, sizeof(on)) == -1)
+            {
+                close(cpfd->fd); cpfd->fd = -1; i++; continue;
+            }
+        }
+#endif
         if (bind(cpfd->fd, ai->ai_addr, ai->ai_addrlen) == -1) {
             close(cpfd->fd); cpfd->fd = -1; i++; continue;
         }
@@ -372,17 +443,18 @@ static gboolean fbListenerInitUDPSocket(
 }
 
 /**
- *fbListenerAlloc
- *
- *
+ *fbListenerAllocInternal
  *
+ * Allocates a listener; binds its passive sockets with SO_REUSEPORT when
+ * reuseport is TRUE.
  *
  */
-fbListener_t *fbListenerAlloc(
+static fbListener_t *fbListenerAllocInternal(
     fbConnSpec_t                *spec,
     fbSession_t                 *session,
     fbListenerAppInit_fn        appinit,
     fbListenerAppFree_fn        appfree,
+    gboolean                    reuseport,
     GError                      **err)
 {
     fbListener_t                *listener = NULL;
@@ -402,6 +474,9 @@ fbListener_t *fbListenerAlloc(
     listener->lsock = -1;
     listener->rip = -1;
     listener->wip = -1;
+#if HAVE_SYS_EPOLL_H
+    listener->epfd = -1;
+#endif
 
     if (ownSocket) { /* user handling own socket creation and connections */
         listener->spec = NULL;
@@ -412,9 +487,11 @@ fbListener_t *fbListenerAlloc(
     listener->session = session;
     listener->appinit = appinit;
     listener->appfree = appfree;
+    listener->reuseport = reuseport;
 
     /* allocate file descriptor table */
     listener->fdtab = g_hash_table_new(g_direct_hash, g_direct_equal);
+    listener->buffered = g_hash_table_new(g_direct_hash, g_direct_equal);
 
     if (!ownSocket) {
         /* Do transport-specific initialization */
@@ -472,6 +549,9 @@ err:
         if (listener->fdtab) {
             g_hash_table_destroy(listener->fdtab);
         }
+        if (listener->buffered) {
+            g_hash_table_destroy(listener->buffered);
+        }
 
         g_slice_free(fbListener_t, listener);
     }
@@ -480,6 +560,54 @@ err:
     return NULL;
 }
 
+/**
+ *fbListenerAlloc
+ *
+ *
+ *
+ *
+ */
+fbListener_t *fbListenerAlloc(
+    fbConnSpec_t                *spec,
+    fbSession_t                 *session,
+    fbListenerAppInit_fn        appinit,
+    fbListenerAppFree_fn        appfree,
+    GError                      **err)
+{
+    return fbListenerAllocInternal(spec, session, appinit, appfree,
+                                   FALSE, err);
+}
+
+/**
+ *fbListenerAllocReusePort
+ *
+ *
+ *
+ *
+ */
+fbListener_t *fbListenerAllocReusePort(
+    fbConnSpec_t                *spec,
+    fbSession_t                 *session,
+    fbListenerAppInit_fn        appinit,
+    fbListenerAppFree_fn        appfree,
+    GError                      **err)
+{
+#ifdef SO_REUSEPORT
+    g_assert(spec);
+    if (spec->transport != FB_UDP && spec->transport != FB_TCP) {
+        g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_IMPL,
+                    "SO_REUSEPORT listeners support only UDP and TCP");
+        return NULL;
+    }
+    return fbListenerAllocInternal(spec, session, appinit, appfree,
+                                   TRUE, err);
+#else
+    g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_IMPL,
+                "SO_REUSEPORT is not supported on this platform");
+    return NULL;
+#endif
+}
+
 
 /**
  * fbListenerFreeBuffer
@@ -575,6 +703,14 @@ void            fbListenerFree(
     }
     /* free the listener table */
     g_hash_table_destroy(listener->fdtab);
+    g_hash_table_destroy(listener->buffered);
+
+#if HAVE_SYS_EPOLL_H
+    if (listener->epfd >= 0) {
+        g_hash_table_destroy(listener->eptab);
+        close(listener->epfd);
+    }
+#endif
 
     /* free the connection specifier */
     fbConnSpecFree(listener->spec);
@@ -654,6 +790,223 @@ static void fbListenerAddPollFD(
     }
 }
 
+#if HAVE_SYS_EPOLL_H
+/**
+ * fbListenerEventQueue
+ *
+ * Adds an entry to its listener's ready queue; the interrupt pipe goes to
+ * the head so an interrupt is seen before any other input.
+ *
+ */
+static void fbListenerEventQueue(
+    fbListenerEvent_t          *ev)
+{
+    fbListener_t               *listener = ev->listener;
+
+    if (ev->queued) {
+        return;
+    }
+    ev->queued = TRUE;
+    if (ev->interrupt) {
+        ev->prev = NULL;
+        ev->next = listener->ready_head;
+        if (listener->ready_head) {
+            listener->ready_head->prev = ev;
+        } else {
+            listener->ready_tail = ev;
+        }
+        listener->ready_head = ev;
+    } else {
+        ev->next = NULL;
+        ev->prev = listener->ready_tail;
+        if (listener->ready_tail) {
+            listener->ready_tail->next = ev;
+        } else {
+            listener->ready_head = ev;
+        }
+        listener->ready_tail = ev;
+    }
+}
+
+/**
+ * fbListenerEventUnqueue
+ *
+ *
+ */
+static void fbListenerEventUnqueue(
+    fbListenerEvent_t          *ev)
+{
+    fbListener_t               *listener = ev->listener;
+
+    if (!ev->queued) {
+        return;
+    }
+    if (ev->prev) {
+        ev->prev->next = ev->next;
+    } else {
+        listener->ready_head = ev->next;
+    }
+    if (ev->next) {
+        ev->next->prev = ev->prev;
+    } else {
+        listener->ready_tail = ev->prev;
+    }
+    ev->next = ev->prev = NULL;
+    ev->queued = FALSE;
+    ev->input = FALSE;
+}
+
+/**
+ * fbListenerEventFree
+ *
+ * Destroy function for the values of a listener's eptab.
+ *
+ */
+static void fbListenerEventFree(
+    gpointer                    vev)
+{
+    fbListenerEvent_t          *ev = (fbListenerEvent_t *)vev;
+
+    fbListenerEventUnqueue(ev);
+    g_slice_free(fbListenerEvent_t, ev);
+}
+
+/**
+ * fbListenerEpollAdd
+ *
+ * Registers a file descriptor with the listener's epoll instance.  fbuf
+ * is the collection buffer of a connection, or NULL for a passive socket.
+ *
+ * @return TRUE on success, FALSE with errno set on failure
+ */
+static gboolean fbListenerEpollAdd(
+    fbListener_t                *listener,
+    int                         fd,
+    fBuf_t                      *fbuf,
+    gboolean                    interrupt)
+{
+    fbListenerEvent_t           *ev;
+    struct epoll_event          event;
+
+    ev = g_slice_new0(fbListenerEvent_t);
+    ev->listener = listener;
+    ev->fbuf = fbuf;
+    ev->fd = fd;
+    ev->interrupt = interrupt;
+
+    memset(&event, 0, sizeof(event));
+    event.events = EPOLLIN;
+    event.data.ptr = ev;
+    if (epoll_ctl(listener->epfd, EPOLL_CTL_ADD, fd, &event) == -1) {
+        g_slice_free(fbListenerEvent_t, ev);
+        return FALSE;
+    }
+
+    g_hash_table_insert(listener->eptab, GINT_TO_POINTER(fd), ev);
+
+    return TRUE;
+}
+
+/**
+ * fbListenerEpollHarvest
+ *
+ * Waits up to timeout milliseconds for events on the listener's epoll
+ * instance and moves the entries that report input onto the ready queue.
+ *
+ * @return the number of events, or -1 on error
+ */
+static int fbListenerEpollHarvest(
+    fbListener_t                *listener,
+    int                         timeout,
+    GError                      **err)
+{
+    struct epoll_event          events[FB_LISTENER_EPOLL_EVENTS];
+    fbListenerEvent_t           *ev;
+    int                         rc;
+    int                         i;
+
+    rc = epoll_wait(listener->epfd, events, FB_LISTENER_EPOLL_EVENTS,
+                    timeout);
+    if (rc < 0) {
+        if (errno == EINTR) {
+            g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_NLREAD,
+                        "Interrupted listener wait");
+        } else {
+            g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_IO,
+                        "listener wait error: %s",
+                        strerror(errno));
+        }
+        return -1;
+    }
+
+    for (i = 0; i < rc; i++) {
+        ev = (fbListenerEvent_t *)events[i].data.ptr;
+        fbListenerEventQueue(ev);
+        ev->input = TRUE;
+    }
+
+    return rc;
+}
+
+/**
+ * fbListenerEpollPop
+ *
+ * Removes and returns the entry at the head of the listener's ready queue,
+ * skipping entries queued for a buffered message that has since been
+ * read, or returns NULL if the queue is empty.
+ *
+ */
+static fbListenerEvent_t *fbListenerEpollPop(
+    fbListener_t                *listener)
+{
+    fbListenerEvent_t           *ev;
+    fBuf_t                      *fbuf;
+    gboolean                    input;
+
+    while ((ev = listener->ready_head)) {
+        input = ev->input;
+        fbListenerEventUnqueue(ev);
+        if (input) {
+            return ev;
+        }
+        fbuf = g_hash_table_lookup(listener->fdtab, GINT_TO_POINTER(ev->fd));
+        if (fbuf && fbCollectorHasBufferedMessage(fBufGetCollector(fbuf))) {
+            return ev;
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * fbListenerEpollNext
+ *
+ * Returns the next entry of the listener with input or a buffered
+ * message, waiting if there is none.  Entries are returned in the order
+ * they became ready, except that the interrupt pipe comes first.
+ *
+ */
+static fbListenerEvent_t *fbListenerEpollNext(
+    fbListener_t                *listener,
+    GError                      **err)
+{
+    fbListenerEvent_t           *ev;
+
+    for (;;) {
+        /* a single non-blocking check picks up an interrupt or new input
+         * while entries are still queued */
+        if (fbListenerEpollHarvest(listener, listener->ready_head ? 0 : -1,
+                                   err) < 0)
+        {
+            return NULL;
+        }
+        if ((ev = fbListenerEpollPop(listener))) {
+            return ev;
+        }
+    }
+}
+#endif  /* HAVE_SYS_EPOLL_H */
+
 /**
  * fbListenerWaitAccept
  *
@@ -731,6 +1084,14 @@ static fBuf_t *fbListenerWaitAccept(
 
     /* don't add to array if fbListenerWaitNoCollectors was called */
     if (listener->mode < 1) {
+#if HAVE_SYS_EPOLL_H
+        if (listener->epfd >= 0) {
+            if (!fbListenerEpollAdd(listener, asock, fbuf, FALSE)) {
+                g_warning("Unable to add connection to epoll set: %s",
+                          strerror(errno));
+            }
+        } else
+#endif
         /* add to poll array */
         if (listener->pfd_len < MAX_CONNECTIONS) {
             fbListenerAddPollFD(listener->pfd_array, &listener->pfd_len,asock);
@@ -763,6 +1124,16 @@ void fbListenerRemove(
 
     /* remove from hash table */
     g_hash_table_remove(listener->fdtab, GINT_TO_POINTER(fd));
+    g_hash_table_remove(listener->buffered, GINT_TO_POINTER(fd));
+
+#if HAVE_SYS_EPOLL_H
+    if (listener->epfd >= 0) {
+        /* closing the socket normally removes it from the epoll set
+         * already, so ignore the result */
+        epoll_ctl(listener->epfd, EPOLL_CTL_DEL, fd, NULL);
+        g_hash_table_remove(listener->eptab, GINT_TO_POINTER(fd));
+    }
+#endif
 
     /* remove from poll array */
     for (i = 0; i < listener->pfd_len; i++) {
@@ -778,6 +1149,138 @@ void fbListenerRemove(
     }
 }
 
+/**
+ * fbListenerQueueBufferedMessage
+ *
+ *
+ */
+void fbListenerQueueBufferedMessage(
+    fbListener_t        *listener,
+    int                 fd)
+{
+#if HAVE_SYS_EPOLL_H
+    if (listener->epfd >= 0) {
+        fbListenerEvent_t *ev = g_hash_table_lookup(listener->eptab,
+                                                    GINT_TO_POINTER(fd));
+        if (ev) {
+            fbListenerEventQueue(ev);
+        }
+        return;
+    }
+#endif
+    g_hash_table_insert(listener->buffered, GINT_TO_POINTER(fd),
+                        GINT_TO_POINTER(fd));
+}
+
+/**
+ * fbListenerBufferedMessage
+ *
+ * Removes a file descriptor from the listener's set of collectors with
+ * buffered messages and returns its buffer, preferring the last buffer
+ * returned, or returns NULL if no collector holds a complete buffered
+ * message.  The collector adds itself back to the set if a complete
+ * message is still buffered after its next read.
+ *
+ */
+static fBuf_t *fbListenerBufferedMessage(
+    fbListener_t                *listener)
+{
+    GHashTableIter              iter;
+    gpointer                    key;
+    fBuf_t                      *fbuf;
+
+    while (g_hash_table_size(listener->buffered)) {
+        if (listener->lastbuf &&
+            g_hash_table_lookup_extended(listener->buffered,
+                                         GINT_TO_POINTER(listener->lsock),
+                                         NULL, NULL))
+        {
+            key = GINT_TO_POINTER(listener->lsock);
+        } else {
+            g_hash_table_iter_init(&iter, listener->buffered);
+            g_hash_table_iter_next(&iter, &key, NULL);
+        }
+        g_hash_table_remove(listener->buffered, key);
+
+        fbuf = g_hash_table_lookup(listener->fdtab, key);
+        if (fbuf &&
+            fbCollectorHasBufferedMessage(fBufGetCollector(fbuf)))
+        {
+            listener->lastbuf = fbuf;
+            listener->lsock = GPOINTER_TO_INT(key);
+            return fbuf;
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * fbListenerReadInterrupt
+ *
+ * Consumes one byte written to the interrupt pipe by fbListenerInterrupt()
+ * once a wait finds the read end readable.
+ *
+ */
+static void fbListenerReadInterrupt(
+    int                         fd)
+{
+    uint8_t                     byte;
+    ssize_t                     rc;
+
+    do {
+        rc = read(fd, &byte, sizeof(byte));
+    } while (rc < 0 && errno == EINTR);
+    /* EAGAIN or EOF leaves nothing to consume; the wait still reports
+     * the interrupt */
+}
+
+/**
+ * fbListenerWaitSocket
+ *
+ * Returns the buffer for a file descriptor that fbListenerWait() found
+ * readable, accepting a new connection on a passive TCP socket.
+ *
+ */
+static fBuf_t *fbListenerWaitSocket(
+    fbListener_t                *listener,
+    int                         got_sock,
+    GError                      **err)
+{
+    fBuf_t                      *fbuf = NULL;
+
+    /* quick solution - check if the fd is the same as last time */
+    if ((listener->lsock == got_sock) && listener->lastbuf) {
+        return listener->lastbuf;
+    }
+
+    listener->lsock = got_sock;
+
+    /* different than last time -> check to see if it's been seen before */
+    if ((fbuf =g_hash_table_lookup(listener->fdtab,GINT_TO_POINTER(got_sock))))
+    {
+        listener->lastbuf = fbuf;
+        if (listener->mode < 0) {
+            /* if UDP set FD on collector for reading */
+            fbCollectorSetFD(fBufGetCollector(fbuf), got_sock);
+        }
+        return fbuf;
+    } else {
+        if (listener->mode >= 0) {
+            /* new connection */
+            fbuf = fbListenerWaitAccept(listener, err);
+            if (!fbuf) return NULL;
+            listener->lastbuf = fbuf;
+            return fbuf;
+        } else {
+            g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_IO,
+                        "listener wait error: invalid FD");
+            /* this is strange bc UDP fbufs are set in fblisteneralloc */
+            return NULL;
+        }
+    }
+}
+
 /**
  * fbListenerWait
  *
@@ -790,11 +1293,38 @@ fBuf_t *fbListenerWait(
     GError                      **err)
 {
     fBuf_t                      *fbuf = NULL;
-    uint8_t                     byte;
     int                         got_sock = -1;
     int                         rc;
     unsigned int                i;
 
+#if HAVE_SYS_EPOLL_H
+    if (listener->epfd >= 0) {
+        fbListenerEvent_t *ev = fbListenerEpollNext(listener, err);
+
+        if (!ev) {
+            return NULL;
+        }
+        if (ev->interrupt) {
+            fbListenerReadInterrupt(ev->fd);
+            g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_NLREAD,
+                        "External interrupt on pipe");
+            return NULL;
+        }
+        if (ev->fbuf) {
+            listener->lsock = ev->fd;
+            listener->lastbuf = ev->fbuf;
+            return ev->fbuf;
+        }
+        return fbListenerWaitSocket(listener, ev->fd, err);
+    }
+#endif
+
+    /* messages held in a collector's receive buffer do not make its
+     * socket readable; return such a buffer before waiting */
+    if ((fbuf = fbListenerBufferedMessage(listener))) {
+        return fbuf;
+    }
+
     /* wait for data available on one of our file descriptors */
     rc = poll(listener->pfd_array, listener->pfd_len, -1);
 
@@ -827,8 +1357,7 @@ fBuf_t *fbListenerWait(
 
         if (i == 0) {
             /* read or write interrupt */
-            /* consume and ignore return */
-            read(pfd->fd, &byte, sizeof(byte));
+            fbListenerReadInterrupt(pfd->fd);
             g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_NLREAD,
                         "External interrupt on pipe");
             return NULL;
@@ -838,36 +1367,7 @@ fBuf_t *fbListenerWait(
         break;
     }
 
-    /* quick solution - check if the fd is the same as last time */
-    if ((listener->lsock == got_sock) && listener->lastbuf) {
-        return listener->lastbuf;
-    }
-
-    listener->lsock = got_sock;
-
-    /* different than last time -> check to see if it's been seen before */
-    if ((fbuf =g_hash_table_lookup(listener->fdtab,GINT_TO_POINTER(got_sock))))
-    {
-        listener->lastbuf = fbuf;
-        if (listener->mode < 0) {
-            /* if UDP set FD on collector for reading */
-            fbCollectorSetFD(fBufGetCollector(fbuf), got_sock);
-        }
-        return fbuf;
-    } else {
-        if (listener->mode >= 0) {
-            /* new connection */
-            fbuf = fbListenerWaitAccept(listener, err);
-            if (!fbuf) return NULL;
-            listener->lastbuf = fbuf;
-            return fbuf;
-        } else {
-            g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_IO,
-                        "listener wait error: invalid FD");
-            /* this is strange bc UDP fbufs are set in fblisteneralloc */
-            return NULL;
-        }
-    }
+    return fbListenerWaitSocket(listener, got_sock, err);
 }
 
 fBuf_t *fbListenerWaitNoCollectors(
@@ -875,7 +1375,6 @@ fBuf_t *fbListenerWaitNoCollectors(
     GError                      **err)
 {
     fBuf_t                      *fbuf = NULL;
-    uint8_t                     byte;
     int                         rc;
     unsigned int                i;
 
@@ -913,8 +1412,7 @@ fBuf_t *fbListenerWaitNoCollectors(
 
         if (i == 0) {
             /* read or write interrupt */
-            /* consume and ignore return */
-            read(pfd->fd, &byte, sizeof(byte));
+            fbListenerReadInterrupt(pfd->fd);
             g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_NLREAD,
                         "External interrupt on pipe");
             return NULL;
@@ -1014,6 +1512,79 @@ gboolean            fbListenerGetCollector(
     return TRUE;
 }
 
+/**
+ * fbListenerEnableEpoll
+ *
+ *
+ */
+gboolean fbListenerEnableEpoll(
+    fbListener_t        *listener,
+    GError              **err)
+{
+#if HAVE_SYS_EPOLL_H
+    fBuf_t              *fbuf;
+    unsigned int        i;
+    int                 fd;
+
+    if (listener->epfd >= 0) {
+        return TRUE;
+    }
+    if (!listener->pfd_len) {
+        g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_IMPL,
+                    "Listener has no sockets to wait on");
+        return FALSE;
+    }
+
+    listener->epfd = epoll_create1(EPOLL_CLOEXEC);
+    if (listener->epfd < 0) {
+        g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_IO,
+                    "Unable to create epoll instance: %s", strerror(errno));
+        return FALSE;
+    }
+    listener->eptab = g_hash_table_new_full(g_direct_hash, g_direct_equal,
+                                            NULL, fbListenerEventFree);
+
+    /* move the interrupt pipe, the passive sockets, and any connections
+     * from the poll array to the epoll set; the write end of the
+     * interrupt pipe (index 1) is never waited on */
+    for (i = 0; i < listener->pfd_len; i++) {
+        fd = listener->pfd_array[i].fd;
+        if (fd < 0 || i == 1) {
+            continue;
+        }
+        fbuf = NULL;
+        if (i >= 2 && listener->mode >= 0) {
+            fbuf = g_hash_table_lookup(listener->fdtab, GINT_TO_POINTER(fd));
+        }
+        if (!fbListenerEpollAdd(listener, fd, fbuf, (i == 0))) {
+            g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_IO,
+                        "Unable to add socket to epoll set: %s",
+                        strerror(errno));
+            g_hash_table_destroy(listener->eptab);
+            listener->eptab = NULL;
+            close(listener->epfd);
+            listener->epfd = -1;
+            return FALSE;
+        }
+    }
+    for (i = 2; i < listener->pfd_len; i++) {
+        fd = listener->pfd_array[i].fd;
+        if (fd >= 0 && listener->mode >= 0 &&
+            g_hash_table_lookup(listener->fdtab, GINT_TO_POINTER(fd)))
+        {
+            /* owned by its collector now */
+            listener->pfd_array[i].fd = -1;
+        }
+    }
+
+    return TRUE;
+#else  /* HAVE_SYS_EPOLL_H */
+    g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_IMPL,
+                "epoll is not supported on this platform");
+    return FALSE;
+#endif  /* HAVE_SYS_EPOLL_H */
+}
+
 /* returns NULL or pointer to allocated group structure */
 
 fbListenerGroup_t* fbListenerGroupAlloc(
@@ -1026,6 +1597,9 @@ fbListenerGroup_t* fbListenerGroupAlloc(
                             MAX_CONNECTIONS* 5 *sizeof(struct pollfd)));
 
     group->head = NULL;
+#if HAVE_SYS_EPOLL_H
+    group->epfd = -1;
+#endif
 
     return group;
 }
@@ -1044,10 +1618,86 @@ void fbListenerGroupFree(
         g_slice_free1((MAX_CONNECTIONS * 5 * sizeof(struct pollfd)),
                       group->group_pfd);
     }
+#if HAVE_SYS_EPOLL_H
+    if (group && group->epfd >= 0) {
+        close(group->epfd);
+    }
+#endif
 
     g_slice_free(fbListenerGroup_t, group);
 }
 
+#if HAVE_SYS_EPOLL_H
+/**
+ * fbListenerGroupEpollAdd
+ *
+ * Switches a listener to epoll and adds its epoll instance to the group's.
+ *
+ */
+static gboolean fbListenerGroupEpollAdd(
+    fbListenerGroup_t   *group,
+    fbListener_t        *listener,
+    GError              **err)
+{
+    struct epoll_event  event;
+
+    if (!fbListenerEnableEpoll(listener, err)) {
+        return FALSE;
+    }
+
+    memset(&event, 0, sizeof(event));
+    event.events = EPOLLIN;
+    event.data.ptr = listener;
+    if (epoll_ctl(group->epfd, EPOLL_CTL_ADD, listener->epfd, &event) == -1) {
+        g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_IO,
+                    "Unable to add listener to epoll set: %s",
+                    strerror(errno));
+        return FALSE;
+    }
+
+    return TRUE;
+}
+#endif  /* HAVE_SYS_EPOLL_H */
+
+/**
+ * fbListenerGroupEnableEpoll
+ *
+ *
+ */
+gboolean fbListenerGroupEnableEpoll(
+    fbListenerGroup_t   *group,
+    GError              **err)
+{
+#if HAVE_SYS_EPOLL_H
+    fbListenerEntry_t   *entry;
+
+    if (group->epfd >= 0) {
+        return TRUE;
+    }
+
+    group->epfd = epoll_create1(EPOLL_CLOEXEC);
+    if (group->epfd < 0) {
+        g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_IO,
+                    "Unable to create epoll instance: %s", strerror(errno));
+        return FALSE;
+    }
+
+    for (entry = group->head; entry; entry = entry->next) {
+        if (!fbListenerGroupEpollAdd(group, entry->listener, err)) {
+            close(group->epfd);
+            group->epfd = -1;
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+#else  /* HAVE_SYS_EPOLL_H */
+    g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_IMPL,
+                "epoll is not supported on this platform");
+    return FALSE;
+#endif  /* HAVE_SYS_EPOLL_H */
+}
+
 /**
  * fbListenerGroupAddListener
  *
@@ -1065,6 +1715,14 @@ int fbListenerGroupAddListener(
         return 2;
     }
 
+#if HAVE_SYS_EPOLL_H
+    if (group->epfd >= 0 &&
+        !fbListenerGroupEpollAdd(group, (fbListener_t *)listener, NULL))
+    {
+        return 1;
+    }
+#endif
+
     entry = g_slice_new0( fbListenerEntry_t );
 
     if (!entry) {
@@ -1120,6 +1778,12 @@ int fbListenerGroupDeleteListener(
                 entry->next->prev = entry->prev;
             }
 
+#if HAVE_SYS_EPOLL_H
+            if (group->epfd >= 0) {
+                epoll_ctl(group->epfd, EPOLL_CTL_DEL, entry->listener->epfd,
+                          NULL);
+            }
+#endif
             /* remove FDs (close will happen later) */
             for (i = 0; i < entry->listener->pfd_len; i++) {
                 for (k = 0; k < group->pfd_len; k++) {
@@ -1179,13 +1843,91 @@ void fbListenerFreeGroupResult(
 
 
 
+#if HAVE_SYS_EPOLL_H
+/**
+ * fbListenerGroupWaitEpoll
+ *
+ * fbListenerGroupWait() for a group using epoll: returns a result for
+ * each connection with input and for each new connection accepted.
+ *
+ */
+static fbListenerGroupResult_t *fbListenerGroupWaitEpoll(
+    fbListenerGroup_t   *group,
+    GError             **err)
+{
+    struct epoll_event          events[FB_LISTENER_EPOLL_EVENTS];
+    int                         rc;
+    int                         i;
+    gboolean                    pending;
+    fbListener_t                *listener;
+    fbListenerEvent_t           *ev;
+    fbListenerEntry_t           *entry       = NULL;
+    fbListenerGroupResult_t     *resultHead  = NULL;
+
+    while (!resultHead) {
+        /* do not block while a listener has queued entries, such as
+         * collectors with buffered messages, which epoll does not report */
+        pending = FALSE;
+        for (entry = group->head; entry; entry = entry->next) {
+            if (entry->listener->ready_head) {
+                pending = TRUE;
+                break;
+            }
+        }
+
+        rc = epoll_wait(group->epfd, events, FB_LISTENER_EPOLL_EVENTS,
+                        pending ? 0 : -1);
+        if (rc < 0) {
+            if (errno == EINTR) {
+                g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_NLREAD,
+                            "Interrupted listener wait");
+            } else {
+                g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_IO,
+                            "listener wait error: %s",
+                            strerror(errno));
+            }
+            return NULL;
+        }
+        for (i = 0; i < rc; i++) {
+            listener = (fbListener_t *)events[i].data.ptr;
+            if (fbListenerEpollHarvest(listener, 0, err) < 0) {
+                return NULL;
+            }
+        }
+
+        for (entry = group->head; entry; entry = entry->next) {
+            listener = entry->listener;
+            while ((ev = fbListenerEpollPop(listener))) {
+                if (ev->interrupt) {
+                    fbListenerReadInterrupt(ev->fd);
+                    g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_NLREAD,
+                                "External interrupt on pipe");
+                    fbListenerFreeGroupResult(resultHead);
+                    return NULL;
+                }
+                if (ev->fbuf) {
+                    listener->lsock = ev->fd;
+                    listener->lastbuf = ev->fbuf;
+                } else if (!fbListenerWaitSocket(listener, ev->fd, err)) {
+                    fbListenerFreeGroupResult(resultHead);
+                    return NULL;
+                }
+                fbListenerNewResult(&resultHead, listener);
+                group->lastlist = entry;
+            }
+        }
+    }
+
+    return resultHead;
+}
+#endif  /* HAVE_SYS_EPOLL_H */
+
 
 fbListenerGroupResult_t* fbListenerGroupWait(
     fbListenerGroup_t   *group,
     GError             **err)
 {
     gboolean                    found;
-    uint8_t                     byte;
     unsigned int                i, k;
     int                         rc;
     int                         new_fd = -1;
@@ -1196,10 +1938,25 @@ fbListenerGroupResult_t* fbListenerGroupWait(
 
     g_assert(group);
 
+#if HAVE_SYS_EPOLL_H
+    if (group->epfd >= 0) {
+        return fbListenerGroupWaitEpoll(group, err);
+    }
+#endif
+
     /* wait for data available on one of our file descriptors */
 
     while (!resultHead) {
-        rc = poll(group->group_pfd, group->pfd_len, -1);
+        /* messages held in a collector's receive buffer do not make its
+         * socket readable; return such buffers without blocking */
+        for (entry = group->head; entry; entry = entry->next) {
+            while (fbListenerBufferedMessage(entry->listener)) {
+                fbListenerNewResult(&resultHead, entry->listener);
+                group->lastlist = entry;
+            }
+        }
+
+        rc = poll(group->group_pfd, group->pfd_len, resultHead ? 0 : -1);
 
         if (rc < 0) {
             if (errno == EINTR) {
@@ -1248,8 +2005,7 @@ fbListenerGroupResult_t* fbListenerGroupWait(
 
                         if (k == 0) {
                             /* read or write interrupt */
-                            /* consume and ignore return */
-                            read(cpfd->fd, &byte, sizeof(byte));
+                            fbListenerReadInterrupt(cpfd->fd);
                             g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_NLREAD,
                                         "External interrupt on pipe");
                             return NULL;
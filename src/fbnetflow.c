@@ -236,6 +236,11 @@ typedef struct fbCollectorNetflowV9TemplateHash_st {
     gboolean                    addSysUpTime;
 } fbCollectorNetflowV9TemplateHash_t;
 
+/**
+ * translation state for one session (peer and observation domain).
+ * Everything but refcount is protected by the session's own lock, so
+ * messages from different sessions are translated without contending.
+ */
 typedef struct fbCollectorNetflowV9Session_st {
     /** template hash */
     GHashTable                 *templateHash;
@@ -245,16 +250,22 @@ typedef struct fbCollectorNetflowV9Session_st {
     uint32_t                    netflowSeqNum;
     /** current ipfix seq num */
     uint32_t                    ipfixSeqNum;
+    /** observation domain of the message being translated */
+    uint32_t                    observation_id;
+    /** one reference for domainHash plus one per translation in progress */
+    volatile gint               refcount;
+    /** protects the members above */
+    pthread_mutex_t             lock;
 } fbCollectorNetflowV9Session_t;
 
 /** defines the extra state needed to convert from NetflowV9 to IPFIX */
 struct fbCollectorNetflowV9State_st {
-    uint64_t                      sysUpTime;
-    uint32_t                      observation_id;
+    /** most recently used session; protected by ts_lock */
     fbSession_t                   *sessionptr;
     fbCollectorNetflowV9Session_t *session;
     /* need to keep templates per domain */
     GHashTable                    *domainHash;
+    /** protects domainHash and the cached session only */
     pthread_mutex_t               ts_lock;
 };
 
@@ -274,13 +285,95 @@ static void         templateHashDestroyHelper(
     g_slice_free(fbCollectorNetflowV9TemplateHash_t, datum);
 }
 
+/**
+ * netflowSessionRelease
+ *
+ * drops a reference to a session and frees the session when it was
+ * the last one.  The reference held by domainHash is dropped when the
+ * session is removed from it, so a session timed out while one of its
+ * messages is being translated is freed once that translation ends.
+ *
+ * @param nfsession the session to release
+ *
+ */
+static void         netflowSessionRelease(
+    fbCollectorNetflowV9Session_t *nfsession)
+{
+    if (!g_atomic_int_dec_and_test(&nfsession->refcount)) {
+        return;
+    }
+    if (nfsession->templateHash) {
+        g_hash_table_destroy(nfsession->templateHash);
+    }
+    pthread_mutex_destroy(&nfsession->lock);
+    g_slice_free(fbCollectorNetflowV9Session_t, nfsession);
+}
+
+/**
+ * netflowSessionUnlock
+ *
+ * unlocks a session returned by netflowSessionAcquire() and drops the
+ * reference taken there
+ *
+ * @param nfsession the session to unlock
+ *
+ */
+static void         netflowSessionUnlock(
+    fbCollectorNetflowV9Session_t *nfsession)
+{
+    pthread_mutex_unlock(&nfsession->lock);
+    netflowSessionRelease(nfsession);
+}
+
 static void         domainHashDestroyHelper(
     gpointer datum)
 {
-    if (((fbCollectorNetflowV9Session_t *)datum)->templateHash) {
-        g_hash_table_destroy(((fbCollectorNetflowV9Session_t *)datum)->templateHash);
+    netflowSessionRelease((fbCollectorNetflowV9Session_t *)datum);
+}
+
+/**
+ * netflowSessionAcquire
+ *
+ * finds or creates the translation state for a session and returns it
+ * locked and with a reference held.  The translator lock is only held
+ * for the lookup.  Release with netflowSessionUnlock().
+ *
+ * @param transState the NetFlow v9 translator state
+ * @param session the fixbuf session of the message's peer and domain
+ *
+ * @return the locked session state
+ *
+ */
+static fbCollectorNetflowV9Session_t *netflowSessionAcquire(
+    struct fbCollectorNetflowV9State_st *transState,
+    fbSession_t                         *session)
+{
+    fbCollectorNetflowV9Session_t       *nfsession = NULL;
+
+    pthread_mutex_lock(&transState->ts_lock);
+
+    if (transState->sessionptr != session) {
+        /* lookup template Hash Table per Domain */
+        transState->session = g_hash_table_lookup(transState->domainHash,
+                                                  session);
+        if (transState->session == NULL) {
+            transState->session = g_slice_new0(fbCollectorNetflowV9Session_t);
+            transState->session->refcount = 1;
+            pthread_mutex_init(&transState->session->lock, NULL);
+            g_hash_table_insert(transState->domainHash, (gpointer)session,
+                                transState->session);
+        }
+        transState->sessionptr = session;
     }
-    g_slice_free(fbCollectorNetflowV9Session_t, datum);
+
+    nfsession = transState->session;
+    g_atomic_int_inc(&nfsession->refcount);
+
+    pthread_mutex_unlock(&transState->ts_lock);
+
+    pthread_mutex_lock(&nfsession->lock);
+
+    return nfsession;
 }
 
 
@@ -327,13 +420,9 @@ static gboolean     fbCollectorDecodeV9MsgVL(
     uint16_t        recordCount;
     uint8_t         *dataBuf;
     uint8_t         *bufOffset;
-    uint64_t        unix_secs;
-    uint64_t        sysuptime;
     int             rc;
     unsigned int    loop;
     uint16_t        setLength;
-    struct fbCollectorNetflowV9State_st     *transState =
-        (struct fbCollectorNetflowV9State_st *)collector->translatorState;
     struct setHeader_st {
         uint16_t    setId;
         uint16_t    setLength;
@@ -357,10 +446,8 @@ static gboolean     fbCollectorDecodeV9MsgVL(
     dataBuf = (uint8_t *)hdr;
     bufOffset = dataBuf + sizeof(hdr);
 
-    /* read the rest of the v9 header, ugly trick ahead:
-    gonna read in the uptime, and then throw away the read
-    and finish reading the rest of the header, dumping the
-    uptime, because we don't really want it */
+    /* read the rest of the v9 header; the uptime stays in the buffer
+       for fbCollectorPostProcV9() to use and remove */
     if ((unsigned int)((bufOffset-dataBuf) + 16) < b_len) {
         g_set_error(err,FB_ERROR_DOMAIN, FB_ERROR_NETFLOWV9,
                     "Error buffer too small to read NetflowV9 message header");
@@ -373,8 +460,6 @@ static gboolean     fbCollectorDecodeV9MsgVL(
         rc = read(collector->stream.fd, bufOffset, 4);
     }
 
-    READU32(bufOffset, sysuptime);
-
     if (4 != rc) {
         g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_NETFLOWV9,
                     "Could not complete read of the Netflow header");
@@ -382,6 +467,8 @@ static gboolean     fbCollectorDecodeV9MsgVL(
         return FALSE;
     }
 
+    bufOffset += 4;
+
     if (TRUE == collector->bufferedStream) {
         rc = fread(bufOffset, 1, 12, collector->stream.fp);
     } else {
@@ -395,17 +482,8 @@ static gboolean     fbCollectorDecodeV9MsgVL(
         return FALSE;
     }
 
-    READU32(bufOffset, unix_secs);
-
     bufOffset += 12;
 
-    /* now calculate time to put in element 160 */
-    /* convert unix_secs to milliseconds then subtract sysuptime
-       sysuptime = (milliseconds since reboot) */
-
-    transState->sysUpTime = (unix_secs * 1000) - sysuptime;
-    transState->sysUpTime = fb_htonll(transState->sysUpTime);
-
     /* so we don't really care about what is in the different sets,
        at this point, we just want to scan through recordCount
        number of them and read the length from each, and sum it,
@@ -469,8 +547,9 @@ static gboolean     fbCollectorDecodeV9MsgVL(
 /**
  * fbCollectorMessageHeaderV9
  *
- * this converts a NetFlow V9 header into something every so slightly
- * closer to an IPFIX header; it dumps the up time with a big memcpy
+ * this checks a NetFlow V9 header and records its observation domain;
+ * the header is converted to IPFIX by fbCollectorPostProcV9(), which
+ * also removes the up time
  *
  * @param collector pointer to the collector state structure
  * @param buffer pointer to the message buffer
@@ -488,11 +567,6 @@ static gboolean    fbCollectorMessageHeaderV9(
     GError                      **err)
 {
     uint16_t                    tempRead16;
-    uint64_t                    unix_secs;
-    uint64_t                    sysuptime;
-    struct fbCollectorNetflowV9State_st     *transState =
-        (struct fbCollectorNetflowV9State_st *)collector->translatorState;
-
 
     if (b_len < 20) {
         g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_NETFLOWV9,
@@ -511,20 +585,10 @@ static gboolean    fbCollectorMessageHeaderV9(
         return FALSE;
     }
 
-    READU32((buffer + 4), sysuptime);
-    READU32((buffer + 8), unix_secs);
     READU32((buffer + 16), collector->obdomain);
     collector->time = time(NULL);
 
-    /* convert to milliseconds - subtract sysuptime to get time of reboot */
-    transState->sysUpTime = (unix_secs * 1000) - sysuptime;
-    transState->sysUpTime = fb_htonll(transState->sysUpTime);
-
-    /* memcpy is no good here because src & dst overlap */
-    memmove((buffer + 4), (buffer + 8), (b_len - 8));
-
-    /* return that we shortened the buffer */
-    *m_len = b_len - 4;
+    *m_len = b_len;
 
     return TRUE;
 }
@@ -541,6 +605,7 @@ static gboolean    fbCollectorMessageHeaderV9(
  * which are not common between IPFIX and NetFlow V9
  *
  * @param collector pointer to the collector state record
+ * @param currentSession the locked state of the message's session
  * @param dataBuf pointer to the buffer holding the template def
  *                points <b>after</b> the set ID and set length
  * @param recordLength pointer to the set header length field
@@ -553,6 +618,7 @@ static gboolean    fbCollectorMessageHeaderV9(
  */
 static int netflowDataTemplateParse(
     fbCollector_t   *collector,
+    fbCollectorNetflowV9Session_t *currentSession,
     uint8_t         *dataBuf,
     uint16_t        *recordLength,
     uint8_t         *msgBuf,
@@ -573,10 +639,7 @@ static int netflowDataTemplateParse(
     uint8_t         addReversePenFix = 0;
 #endif
     gboolean        addSysUpTime = FALSE;
-    struct fbCollectorNetflowV9State_st     *transState =
-        (struct fbCollectorNetflowV9State_st *)collector->translatorState;
     struct fbCollectorNetflowV9TemplateHash_st *newTemplate = NULL;
-    fbCollectorNetflowV9Session_t *currentSession = transState->session;
 
     if ((recLength < 8) || 0 != (recLength % 4)) {
         g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_NETFLOWV9,
@@ -788,7 +851,7 @@ static int netflowDataTemplateParse(
         fprintf(stderr, "template inserted into hash: templateId %d,"
                 " templateSize: %d, Domain: %04x, SysUpTime %d, "
                 "fieldCount: %d \n",
-                templateId, targetRecSize, transState->observation_id,
+                templateId, targetRecSize, currentSession->observation_id,
                 newTemplate->addSysUpTime, fieldCount);
 #endif
         targetRecSize = 0; /* running tmpl size needs reset */
@@ -810,6 +873,7 @@ static int netflowDataTemplateParse(
  * it will error out on malformed templates
  *
  * @param collector pointer to the collector state record
+ * @param currentSession the locked state of the message's session
  * @param dataBuf pointer to the buffer holding the template def
  *                points <b>after</b> the set ID and set length
  * @param recordLength a pointer to the length of the flowSet
@@ -820,6 +884,7 @@ static int netflowDataTemplateParse(
  */
 static int netflowOptionsTemplateParse(
     fbCollector_t   *collector,
+    fbCollectorNetflowV9Session_t *currentSession,
     uint8_t         *dataBuf,
     uint16_t        *recordLength,
     GError          **err)
@@ -835,10 +900,7 @@ static int netflowOptionsTemplateParse(
     unsigned int    loop;
     unsigned int    fieldCount;
     int             tmplcount = 0;
-    struct fbCollectorNetflowV9State_st     *transState =
-        (struct fbCollectorNetflowV9State_st *)collector->translatorState;
     struct fbCollectorNetflowV9TemplateHash_st *newTemplate = NULL;
-    fbCollectorNetflowV9Session_t *currentSession = transState->session;
 
     while (lengthParsed < recLength) {
 
@@ -967,7 +1029,7 @@ static int netflowOptionsTemplateParse(
         fprintf(stderr, "Options template inserted into hash: templateId %d,"
                 " templateSize: %d, Domain: %04x, SysUpTime %d, "
                 "fieldCount: %u \n",
-                templateId, templateLength, transState->observation_id,
+                templateId, templateLength, currentSession->observation_id,
                 newTemplate->addSysUpTime, fieldCount);
 #endif
 
@@ -1014,6 +1076,8 @@ static gboolean     fbCollectorPostProcV9(
     struct fbCollectorNetflowV9State_st     *transState =
         (struct fbCollectorNetflowV9State_st *)collector->translatorState;
     uint32_t          timeStamp;
+    uint32_t          sysuptime;
+    uint64_t          sysUpTime;
     uint32_t          obsDomain;
     uint16_t          version;
     uint32_t          *seqNumPtr;
@@ -1053,8 +1117,21 @@ static gboolean     fbCollectorPostProcV9(
 
     lengthCountPtr = (uint16_t *)msgOsetPtr;
     READU16INC(msgOsetPtr, recordCount);
+
+    /* the up time is kept with the message rather than in the translator
+       state; remove it to leave an IPFIX header.  memcpy is no good here
+       because src & dst overlap */
+    READU32(msgOsetPtr, sysuptime);
+    memmove(msgOsetPtr, (msgOsetPtr + 4),
+            *bufLen - ((msgOsetPtr + 4) - dataBuf));
+    *bufLen -= 4;
     READU32INC(msgOsetPtr, timeStamp);
 
+    /* convert to milliseconds - subtract sysuptime to get time of reboot;
+       this is the value put in element 160 */
+    sysUpTime = ((uint64_t)timeStamp * 1000) - sysuptime;
+    sysUpTime = fb_htonll(sysUpTime);
+
     seqNumPtr = (uint32_t *)msgOsetPtr;
     READU32INC(msgOsetPtr, netflowSeqNum);
 
@@ -1065,25 +1142,10 @@ static gboolean     fbCollectorPostProcV9(
     /* read the observation domain */
     READU32INC(msgOsetPtr, obsDomain);
 
-    pthread_mutex_lock(&transState->ts_lock);
-
-    transState->observation_id = obsDomain;
+    currentSession = netflowSessionAcquire(transState,
+                                           collector->udp_head->session);
 
-    if (transState->sessionptr != collector->udp_head->session) {
-        /* lookup template Hash Table per Domain */
-        transState->session =
-            g_hash_table_lookup(transState->domainHash,
-                                collector->udp_head->session);
-        if (transState->session == NULL) {
-            transState->session = g_slice_new0(fbCollectorNetflowV9Session_t);
-            g_hash_table_insert(transState->domainHash,
-                                (gpointer)collector->udp_head->session,
-                                transState->session);
-        }
-        transState->sessionptr = collector->udp_head->session;
-    }
-
-    currentSession = transState->session;
+    currentSession->observation_id = obsDomain;
 
     /* seq num logic */
     if (currentSession->netflowSeqNum != netflowSeqNum) {
@@ -1098,7 +1160,7 @@ static gboolean     fbCollectorPostProcV9(
             if (seq_diff > 0) {
                 if (seq_diff > NF_MAX_SEQ_DIFF) {
                     /* check for reboot */
-                    if (transState->sysUpTime > NF_REBOOT_SECS) {
+                    if (sysUpTime > NF_REBOOT_SECS) {
                         /* probably not a reboot so account for missed */
                         currentSession->netflowMissed += seq_diff;
                     } /* else - reboot? don't add to missed count */
@@ -1150,7 +1212,7 @@ static gboolean     fbCollectorPostProcV9(
             g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_NETFLOWV9,
                         "Invalid Netflow %s Record Length (%u < 4)",
                         ((1 == setId) ? "Options" : "Data"), recordLength);
-            pthread_mutex_unlock(&transState->ts_lock);
+            netflowSessionUnlock(currentSession);
             return FALSE;
         }
         /* Check to make sure we won't overrun buffer - Add 4 for set header */
@@ -1160,7 +1222,7 @@ static gboolean     fbCollectorPostProcV9(
                         "larger than remaining buffer length (%ld)",
                         (1 == setId) ? "Options" : "Record",
                         recordLength, ((dataBuf + *bufLen + 4) - msgOsetPtr));
-            pthread_mutex_unlock(&transState->ts_lock);
+            netflowSessionUnlock(currentSession);
             return FALSE;
         }
 
@@ -1169,11 +1231,11 @@ static gboolean     fbCollectorPostProcV9(
             /* Template SET ID = 0 in netflow, 2 in IPFIX */
             WRITEU16(msgOsetPtr-2*sizeof(uint16_t), 2);
 
-            tmpls_parsed = netflowDataTemplateParse(collector, msgOsetPtr,
-                                                    recLengthPtr,
+            tmpls_parsed = netflowDataTemplateParse(collector, currentSession,
+                                                    msgOsetPtr, recLengthPtr,
                                                     dataBuf, bufLen, err);
             if (!tmpls_parsed) {
-                pthread_mutex_unlock(&transState->ts_lock);
+                netflowSessionUnlock(currentSession);
                 return FALSE;
             }
 
@@ -1191,11 +1253,13 @@ static gboolean     fbCollectorPostProcV9(
             /* Template SET ID = 3 for IPFIX */
             WRITEU16(msgOsetPtr-2*sizeof(uint16_t),3);
 
-            tmpls_parsed = netflowOptionsTemplateParse(collector, msgOsetPtr,
+            tmpls_parsed = netflowOptionsTemplateParse(collector,
+                                                       currentSession,
+                                                       msgOsetPtr,
                                                        recLengthPtr, err);
             if (!tmpls_parsed) {
                 /* Needs to contain at least 1 */
-                pthread_mutex_unlock(&transState->ts_lock);
+                netflowSessionUnlock(currentSession);
                 return FALSE;
             }
 
@@ -1210,7 +1274,7 @@ static gboolean     fbCollectorPostProcV9(
             /* data records must be 256 or higher */
             g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_NETFLOWV9,
                         "NetFlow record type (%u) is not supported", setId);
-            pthread_mutex_unlock(&transState->ts_lock);
+            netflowSessionUnlock(currentSession);
             return FALSE;
 
         } else {
@@ -1226,7 +1290,7 @@ static gboolean     fbCollectorPostProcV9(
                                 "No Templates Present for this session."
                                 " %u Flows Lost.", recordCount-recordCounter);
                     currentSession->netflowSeqNum++;
-                    pthread_mutex_unlock(&transState->ts_lock);
+                    netflowSessionUnlock(currentSession);
                     return FALSE;
                 }
                 /* else, remove these bytes from the packet */
@@ -1253,7 +1317,7 @@ static gboolean     fbCollectorPostProcV9(
                                 " %u Flows Lost.", setId,
                                 (recordCount-recordCounter));
                     currentSession->netflowSeqNum++;
-                    pthread_mutex_unlock(&transState->ts_lock);
+                    netflowSessionUnlock(currentSession);
                     return FALSE;
                 }
                 /* else, remove these bytes from the packet */
@@ -1284,7 +1348,7 @@ static gboolean     fbCollectorPostProcV9(
                 if (numberRecordsInSet == 0) {
                     g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_NETFLOWV9,
                                 "NetFlow Data Record with 0 Records");
-                    pthread_mutex_unlock(&transState->ts_lock);
+                    netflowSessionUnlock(currentSession);
                     return FALSE;
                 }
 
@@ -1301,14 +1365,14 @@ static gboolean     fbCollectorPostProcV9(
                                         "NetFlow V9 unable to convert "
                                         "information model "
                                         "time elements, no space");
-                            pthread_mutex_unlock(&transState->ts_lock);
+                            netflowSessionUnlock(currentSession);
                             return FALSE;
                         }
 
                         memmove((msgOsetPtr + sizeof(uint64_t)), msgOsetPtr,
                                 (*bufLen - (msgOsetPtr - dataBuf)));
                         /* add sysUpTime to flow record */
-                        memcpy(msgOsetPtr, &(transState->sysUpTime),
+                        memcpy(msgOsetPtr, &sysUpTime,
                                sizeof(uint64_t));
                         msgOsetPtr += sizeof(uint64_t);
                         *bufLen += sizeof(uint64_t);
@@ -1335,7 +1399,7 @@ static gboolean     fbCollectorPostProcV9(
                     "%u, processed %u)", (unsigned int)(*bufLen),
                     ntohs(*lengthCountPtr));
         currentSession->netflowSeqNum++;
-        pthread_mutex_unlock(&transState->ts_lock);
+        netflowSessionUnlock(currentSession);
         return FALSE;
     }
 
@@ -1375,7 +1439,7 @@ static gboolean     fbCollectorPostProcV9(
     }
 #endif
 
-    pthread_mutex_unlock(&transState->ts_lock);
+    netflowSessionUnlock(currentSession);
 
     return TRUE;
 }
@@ -1501,8 +1565,8 @@ gboolean    fbCollectorSetNetflowV9Translator(
 #endif
 
     nflowState->domainHash = hashTable;
-    nflowState->observation_id = 0;
     nflowState->sessionptr = NULL;
+    nflowState->session = NULL;
     pthread_mutex_init(&nflowState->ts_lock, NULL);
 
     return fbCollectorSetTranslator(collector, fbCollectorPostProcV9,
@@ -1589,7 +1653,9 @@ uint32_t fbCollectorGetNetflowMissed(
     }
 
     if (ts_session) {
+        pthread_mutex_lock(&ts_session->lock);
         missed = ts_session->netflowMissed;
+        pthread_mutex_unlock(&ts_session->lock);
     }
 
     pthread_mutex_unlock(&ts->ts_lock);
@@ -48,8 +48,11 @@
 #define FB_DEBUG_MD 0
 #endif
 
-/** Size of the tmpl_pair_array */
-#define TMPL_PAIR_ARRAY_SIZE    (sizeof(uint16_t) * (1 << 16))
+/** Number of external TIDs covered by one page of a fbTemplatePairs_t */
+#define TMPL_PAIR_PAGE_COUNT    256
+
+/** Size in octets of one page of a fbTemplatePairs_t */
+#define TMPL_PAIR_PAGE_SIZE     (sizeof(uint16_t) * TMPL_PAIR_PAGE_COUNT)
 
 #if HAVE_SPREAD
 /* Lock the mutex on session 's' when spread is active */
@@ -62,6 +65,45 @@
 #define FB_SPREAD_MUTEX_UNLOCK(s)
 #endif  /* HAVE_SPREAD */
 
+/** Number of template IDs covered by one page of a fbTemplateTable_t */
+#define FB_TTAB_PAGE_COUNT      256
+
+/** Size in octets of one page of a fbTemplateTable_t */
+#define FB_TTAB_PAGE_SIZE       (sizeof(fbTemplate_t *) * FB_TTAB_PAGE_COUNT)
+
+/**
+ * A template table: maps template ID to template.  Lookups index a
+ * sparse two-level array directly, using the high byte of the ID to
+ * select a page and the low byte to select the slot in it; a page is
+ * allocated when the first template in its range is added and is kept
+ * until the table is freed, so a slot's address never changes.  The
+ * hash table holds the same templates and is used for iteration.
+ */
+typedef struct fbTemplateTable_st {
+    /** Pages of templates, or NULL for a page with no templates yet */
+    fbTemplate_t        **page[(1 << 16) / FB_TTAB_PAGE_COUNT];
+    /** Maps template ID to template */
+    GHashTable          *hash;
+} fbTemplateTable_t;
+
+/**
+ * The template pairs of a session: maps external template ID to
+ * internal template ID.  Stored as a sparse two-level array indexed by
+ * the high and low bytes of the external TID, where a page is
+ * allocated only when a pair in its range is added.  A table may be
+ * shared by a session and its clones; it is copied by the first
+ * session that modifies it while it is shared.
+ */
+typedef struct fbTemplatePairs_st {
+    /** Pages of internal TIDs, or NULL for a page with no pairs */
+    uint16_t            *page[(1 << 16) / TMPL_PAIR_PAGE_COUNT];
+    /** Number of sessions using this table */
+    volatile gint       refcount;
+    /** Number of pairs in the table.  The table is freed when the
+     * last pair is removed. */
+    uint32_t            count;
+} fbTemplatePairs_t;
+
 /* FIXME: Consider changing fbSession so the ext_FOO/int_FOO pairs of
  * members become a FOO[2] array and the `internal` gboolean used by
  * several function is used as the index into those arrays. */
@@ -72,18 +114,17 @@ struct fbSession_st {
     /**
      * Internal template table. Maps template ID to internal template.
      */
-    GHashTable                  *int_ttab;
+    fbTemplateTable_t           *int_ttab;
     /**
      * External template table for current observation domain.
      * Maps template ID to external template.
      */
-    GHashTable                  *ext_ttab;
+    fbTemplateTable_t           *ext_ttab;
     /**
-     * Array of size 2^16 where index is external TID and value is
-     * internal TID.  The number if valid entries in the array is
-     * maintained by 'num_tmpl_pairs'.
+     * Template pairs; maps external TID to internal TID.  NULL when
+     * the session has no pairs.  May be shared with cloned sessions.
      */
-    uint16_t                    *tmpl_pair_array;
+    fbTemplatePairs_t           *tmpl_pairs;
     /**
      * Callback function to allow an application to assign template
      * pairs for transcoding purposes, and to add context to a
@@ -129,11 +170,6 @@ struct fbSession_st {
      * Error description for fbSessionExportTemplates()
      */
     GError                      *tdyn_err;
-    /**
-     * The number of valid pairs in 'tmpl_pair_array'.  Used to free
-     * the array when it is empty.
-     */
-    uint16_t                    num_tmpl_pairs;
     /**
      * The TID to use for exporting enterprise-specific IEs when
      * export_info_element_metadata is true.
@@ -244,6 +280,81 @@ static uint16_t fbSessionSpreadAddTemplatesHelper(
     GError         **err);
 #endif  /* HAVE_SPREAD */
 
+/**
+ *    Allocates an empty template table.
+ */
+static fbTemplateTable_t *fbSessionTableAlloc(
+    void)
+{
+    fbTemplateTable_t *ttab = g_slice_new0(fbTemplateTable_t);
+
+    ttab->hash = g_hash_table_new(g_direct_hash, g_direct_equal);
+    return ttab;
+}
+
+/**
+ *    Frees a template table.  Does not release the templates in it.
+ */
+static void fbSessionTableFree(
+    fbTemplateTable_t  *ttab)
+{
+    unsigned int        i;
+
+    for (i = 0; i < G_N_ELEMENTS(ttab->page); ++i) {
+        if (ttab->page[i]) {
+            g_slice_free1(FB_TTAB_PAGE_SIZE, ttab->page[i]);
+        }
+    }
+    g_hash_table_destroy(ttab->hash);
+    g_slice_free(fbTemplateTable_t, ttab);
+}
+
+/**
+ *    Returns the template with ID `tid` in a template table, or NULL.
+ */
+static fbTemplate_t *fbSessionTableLookup(
+    const fbTemplateTable_t  *ttab,
+    uint16_t                  tid)
+{
+    fbTemplate_t       **page = ttab->page[tid / FB_TTAB_PAGE_COUNT];
+
+    return page ? page[tid % FB_TTAB_PAGE_COUNT] : NULL;
+}
+
+/**
+ *    Stores `tmpl` as the template with ID `tid` in a template table,
+ *    replacing any template there.
+ */
+static void fbSessionTableInsert(
+    fbTemplateTable_t  *ttab,
+    uint16_t            tid,
+    fbTemplate_t       *tmpl)
+{
+    fbTemplate_t      **page = ttab->page[tid / FB_TTAB_PAGE_COUNT];
+
+    if (!page) {
+        page = (fbTemplate_t **)g_slice_alloc0(FB_TTAB_PAGE_SIZE);
+        ttab->page[tid / FB_TTAB_PAGE_COUNT] = page;
+    }
+    page[tid % FB_TTAB_PAGE_COUNT] = tmpl;
+    g_hash_table_insert(ttab->hash, GUINT_TO_POINTER((unsigned int)tid), tmpl);
+}
+
+/**
+ *    Removes the template with ID `tid` from a template table.
+ */
+static void fbSessionTableRemove(
+    fbTemplateTable_t  *ttab,
+    uint16_t            tid)
+{
+    fbTemplate_t      **page = ttab->page[tid / FB_TTAB_PAGE_COUNT];
+
+    if (page) {
+        page[tid % FB_TTAB_PAGE_COUNT] = NULL;
+    }
+    g_hash_table_remove(ttab->hash, GUINT_TO_POINTER((unsigned int)tid));
+}
+
 fbSession_t     *fbSessionAlloc(
     fbInfoModel_t   *model)
 {
@@ -256,7 +367,7 @@ fbSession_t     *fbSessionAlloc(
     session->model = model;
 
     /* Allocate internal template table */
-    session->int_ttab = g_hash_table_new(g_direct_hash, g_direct_equal);
+    session->int_ttab = fbSessionTableAlloc();
 
 #if HAVE_SPREAD
     /* this lock is needed only if Spread is enabled */
@@ -266,8 +377,7 @@ fbSession_t     *fbSessionAlloc(
     /* Reset session externals (will allocate domain template tables, etc.) */
     fbSessionResetExternal(session);
 
-    session->tmpl_pair_array = NULL;
-    session->num_tmpl_pairs = 0;
+    session->tmpl_pairs = NULL;
     session->new_template_callback = NULL;
 
     session->int_next_tid = UINT16_MAX;
@@ -697,35 +807,101 @@ void *fbSessionNewTemplateCallbackAppCtx(
     return session->tmpl_app_ctx;
 }
 
+/**
+ *    Releases a reference to a template pair table, freeing it when
+ *    no session uses it.
+ */
+static void fbSessionPairsRelease(
+    fbTemplatePairs_t  *pairs)
+{
+    unsigned int        i;
+
+    if (!pairs || !g_atomic_int_dec_and_test(&pairs->refcount)) {
+        return;
+    }
+    for (i = 0; i < G_N_ELEMENTS(pairs->page); ++i) {
+        if (pairs->page[i]) {
+            g_slice_free1(TMPL_PAIR_PAGE_SIZE, pairs->page[i]);
+        }
+    }
+    g_slice_free(fbTemplatePairs_t, pairs);
+}
+
+/**
+ *    Returns the template pair table of `session` after ensuring the
+ *    session is its only user, copying the table if it is shared.
+ *    Allocates an empty table if the session has none.
+ */
+static fbTemplatePairs_t *fbSessionPairsForWrite(
+    fbSession_t        *session)
+{
+    fbTemplatePairs_t  *pairs = session->tmpl_pairs;
+    fbTemplatePairs_t  *copy;
+    unsigned int        i;
+
+    if (pairs && g_atomic_int_get(&pairs->refcount) == 1) {
+        return pairs;
+    }
+    copy = g_slice_new0(fbTemplatePairs_t);
+    copy->refcount = 1;
+    if (pairs) {
+        for (i = 0; i < G_N_ELEMENTS(pairs->page); ++i) {
+            if (pairs->page[i]) {
+                copy->page[i] = (uint16_t *)g_slice_copy(
+                    TMPL_PAIR_PAGE_SIZE, pairs->page[i]);
+            }
+        }
+        copy->count = pairs->count;
+        fbSessionPairsRelease(pairs);
+    }
+    session->tmpl_pairs = copy;
+    return copy;
+}
+
+/**
+ *    Sets the internal TID paired with `ext_tid`.
+ */
+static void fbSessionPairsSet(
+    fbSession_t        *session,
+    uint16_t            ext_tid,
+    uint16_t            int_tid)
+{
+    fbTemplatePairs_t  *pairs = fbSessionPairsForWrite(session);
+    uint16_t          **page = &pairs->page[ext_tid / TMPL_PAIR_PAGE_COUNT];
+
+    if (!*page) {
+        *page = (uint16_t *)g_slice_alloc0(TMPL_PAIR_PAGE_SIZE);
+    }
+    (*page)[ext_tid % TMPL_PAIR_PAGE_COUNT] = int_tid;
+    pairs->count++;
+}
+
+/**
+ *    Returns the internal TID paired with `ext_tid`, or 0 if none.
+ */
+static uint16_t fbSessionPairsGet(
+    const fbTemplatePairs_t    *pairs,
+    uint16_t                    ext_tid)
+{
+    const uint16_t *page = pairs->page[ext_tid / TMPL_PAIR_PAGE_COUNT];
+
+    return page ? page[ext_tid % TMPL_PAIR_PAGE_COUNT] : 0;
+}
+
 void fbSessionAddTemplatePair(
     fbSession_t    *session,
     uint16_t        ext_tid,
     uint16_t        int_tid)
 {
-    gboolean madeTable = FALSE;
-
-    if (!session->tmpl_pair_array) {
-        session->tmpl_pair_array =
-            (uint16_t*)g_slice_alloc0(TMPL_PAIR_ARRAY_SIZE);
-        madeTable = TRUE;
-    }
-
     if ((ext_tid == int_tid) || (int_tid == 0)) {
-        session->tmpl_pair_array[ext_tid] = int_tid;
-        session->num_tmpl_pairs++;
+        fbSessionPairsSet(session, ext_tid, int_tid);
         return;
     }
 
     /* external and internal tids are different */
     /* only add the template pair if the internal template exists */
     if (fbSessionGetTemplate(session, TRUE, int_tid, NULL)) {
-        session->tmpl_pair_array[ext_tid] = int_tid;
-        session->num_tmpl_pairs++;
-    } else {
-        if (madeTable) {
-            g_slice_free1(TMPL_PAIR_ARRAY_SIZE, session->tmpl_pair_array);
-            session->tmpl_pair_array = NULL;
-        }
+        fbSessionPairsSet(session, ext_tid, int_tid);
     }
 }
 
@@ -733,20 +909,24 @@ void fbSessionRemoveTemplatePair(
     fbSession_t    *session,
     uint16_t        ext_tid)
 {
-    if (!session->tmpl_pair_array) {
+    fbTemplatePairs_t  *pairs;
+
+    if (!session->tmpl_pairs
+        || !fbSessionPairsGet(session->tmpl_pairs, ext_tid))
+    {
         return;
     }
 
-    if (session->tmpl_pair_array[ext_tid]) {
-        session->num_tmpl_pairs--;
-        if (!session->num_tmpl_pairs) {
-            /* this was the last one, free the array */
-            g_slice_free1(TMPL_PAIR_ARRAY_SIZE, session->tmpl_pair_array);
-            session->tmpl_pair_array = NULL;
-            return;
-        }
-        session->tmpl_pair_array[ext_tid] = 0;
+    pairs = fbSessionPairsForWrite(session);
+    pairs->count--;
+    if (!pairs->count) {
+        /* this was the last one, free the table */
+        fbSessionPairsRelease(pairs);
+        session->tmpl_pairs = NULL;
+        return;
     }
+    pairs->page[ext_tid / TMPL_PAIR_PAGE_COUNT][ext_tid % TMPL_PAIR_PAGE_COUNT]
+        = 0;
 }
 
 uint16_t    fbSessionLookupTemplatePair(
@@ -756,11 +936,11 @@ uint16_t    fbSessionLookupTemplatePair(
     /* if there are no current pairs, just return ext_tid because that means
      * we should decode the entire external template
      */
-    if (!session->tmpl_pair_array) {
+    if (!session->tmpl_pairs) {
         return ext_tid;
     }
 
-    return session->tmpl_pair_array[ext_tid];
+    return fbSessionPairsGet(session->tmpl_pairs, ext_tid);
 }
 
 static void     fbSessionFreeOneTemplate(
@@ -773,11 +953,11 @@ static void     fbSessionFreeOneTemplate(
 }
 
 static void     fbSessionResetOneDomain(
-    void            *vdomain __attribute__((unused)),
-    GHashTable      *ttab,
-    fbSession_t     *session)
+    void                *vdomain __attribute__((unused)),
+    fbTemplateTable_t   *ttab,
+    fbSession_t         *session)
 {
-    g_hash_table_foreach(ttab,
+    g_hash_table_foreach(ttab->hash,
                          (GHFunc)fbSessionFreeOneTemplate, session);
 }
 
@@ -796,7 +976,7 @@ void            fbSessionResetExternal(
     /* Allocate domain template table */
     session->dom_ttab =
         g_hash_table_new_full(g_direct_hash, g_direct_equal,
-                              NULL, (GDestroyNotify)g_hash_table_destroy);
+                              NULL, (GDestroyNotify)fbSessionTableFree);
 
     /* Null out stale external template table */
     FB_SPREAD_MUTEX_LOCK(session);
@@ -824,7 +1004,7 @@ void            fbSessionResetExternal(
     /*Allocate group template table */
     session->grp_ttab =
         g_hash_table_new_full(g_direct_hash, g_direct_equal,
-                              NULL, (GDestroyNotify)g_hash_table_destroy);
+                              NULL, (GDestroyNotify)fbSessionTableFree);
     if (session->grp_seqtab) {
         g_hash_table_destroy(session->grp_seqtab);
     }
@@ -848,15 +1028,15 @@ void            fbSessionFree(
         return;
     }
     fbSessionResetExternal(session);
-    g_hash_table_foreach(session->int_ttab,
+    g_hash_table_foreach(session->int_ttab->hash,
                          (GHFunc)fbSessionFreeOneTemplate, session);
-    g_hash_table_destroy(session->int_ttab);
+    fbSessionTableFree(session->int_ttab);
     g_hash_table_destroy(session->dom_ttab);
     if (session->dom_seqtab) {
         g_hash_table_destroy(session->dom_seqtab);
     }
-    g_slice_free1(TMPL_PAIR_ARRAY_SIZE, session->tmpl_pair_array);
-    session->tmpl_pair_array = NULL;
+    fbSessionPairsRelease(session->tmpl_pairs);
+    session->tmpl_pairs = NULL;
 #if HAVE_SPREAD
     if (session->grp_ttab) {
         g_hash_table_destroy(session->grp_ttab);
@@ -882,7 +1062,7 @@ void            fbSessionSetDomain(
                                              GUINT_TO_POINTER(domain) );
     if (!session->ext_ttab)
     {
-        session->ext_ttab = g_hash_table_new(g_direct_hash, g_direct_equal);
+        session->ext_ttab = fbSessionTableAlloc();
         g_hash_table_insert(session->dom_ttab, GUINT_TO_POINTER(domain),
                             session->ext_ttab);
     }
@@ -909,27 +1089,27 @@ static uint16_t fbSessionFindUnusedTemplateId(
     gboolean        internal)
 {
     /* Select a template table to add the template to */
-    GHashTable *ttab = internal ? session->int_ttab : session->ext_ttab;
+    fbTemplateTable_t *ttab = internal ? session->int_ttab : session->ext_ttab;
     uint16_t tid = 0;
 
     if (internal) {
-        if (g_hash_table_size(ttab) == (UINT16_MAX - FB_TID_MIN_DATA)) {
+        if (g_hash_table_size(ttab->hash) == (UINT16_MAX - FB_TID_MIN_DATA)) {
             return 0;
         }
         tid = session->int_next_tid;
-        while (g_hash_table_lookup(ttab, GUINT_TO_POINTER((unsigned int)tid))){
+        while (fbSessionTableLookup(ttab, tid)) {
             tid = ((tid > FB_TID_MIN_DATA) ? (tid - 1) : UINT16_MAX);
         }
         session->int_next_tid =
             ((tid > FB_TID_MIN_DATA) ? (tid - 1) : UINT16_MAX);
     } else {
         FB_SPREAD_MUTEX_LOCK(session);
-        if (g_hash_table_size(ttab) == (UINT16_MAX - FB_TID_MIN_DATA)) {
+        if (g_hash_table_size(ttab->hash) == (UINT16_MAX - FB_TID_MIN_DATA)) {
             FB_SPREAD_MUTEX_UNLOCK(session);
             return 0;
         }
         tid = session->ext_next_tid;
-        while (g_hash_table_lookup(ttab, GUINT_TO_POINTER((unsigned int)tid))){
+        while (fbSessionTableLookup(ttab, tid)) {
             tid = ((tid < UINT16_MAX) ? (tid + 1) : FB_TID_MIN_DATA);
         }
         session->ext_next_tid =
@@ -1005,7 +1185,7 @@ void            fbSessionSetPrivateGroup(
                                             GUINT_TO_POINTER(group_offset));
 
     if (!session->ext_ttab) {
-        session->ext_ttab = g_hash_table_new(g_direct_hash, g_direct_equal);
+        session->ext_ttab = fbSessionTableAlloc();
         g_hash_table_insert(session->grp_ttab, GUINT_TO_POINTER(group_offset),
                             session->ext_ttab);
     }
@@ -1054,7 +1234,7 @@ static uint16_t fbSessionSpreadAddTemplatesHelper(
 {
     int n;
     unsigned int group_offset;
-    GHashTable *ttab;
+    fbTemplateTable_t *ttab;
 
     g_assert(tmpl);
     g_assert(tid == FB_TID_AUTO || tid >= FB_TID_MIN_DATA);
@@ -1107,7 +1287,7 @@ static uint16_t fbSessionSpreadAddTemplatesHelper(
                                                GUINT_TO_POINTER(group_offset));
 
         if (!session->ext_ttab) {
-            session->ext_ttab = g_hash_table_new(g_direct_hash,g_direct_equal);
+            session->ext_ttab = fbSessionTableAlloc();
             g_hash_table_insert(session->grp_ttab,
                                 GUINT_TO_POINTER(group_offset),
                                 session->ext_ttab);
@@ -1139,7 +1319,7 @@ static uint16_t fbSessionSpreadAddTemplatesHelper(
         if (!internal)
             FB_SPREAD_MUTEX_LOCK(session);
 
-        g_hash_table_insert(ttab, GUINT_TO_POINTER((unsigned int)tid), tmpl);
+        fbSessionTableInsert(ttab, tid, tmpl);
 
         if (!internal)
             FB_SPREAD_MUTEX_UNLOCK(session);
@@ -1281,7 +1461,7 @@ void            fbSessionSetGroup(
                                                GUINT_TO_POINTER(group_offset));
 
         if (!session->ext_ttab) {
-            session->ext_ttab =g_hash_table_new(g_direct_hash, g_direct_equal);
+            session->ext_ttab = fbSessionTableAlloc();
             g_hash_table_insert(session->grp_ttab,
                                 GUINT_TO_POINTER(group_offset),
                                 session->ext_ttab);
@@ -1344,7 +1524,7 @@ static uint16_t fbSessionAddTemplateHelper(
     const char           *description,
     GError               **err)
 {
-    GHashTable *ttab;
+    fbTemplateTable_t *ttab;
 
     g_assert(tmpl);
     g_assert(tid == FB_TID_AUTO || tid >= FB_TID_MIN_DATA);
@@ -1399,7 +1579,7 @@ static uint16_t fbSessionAddTemplateHelper(
     if (!internal)
         FB_SPREAD_MUTEX_LOCK(session);
 #endif
-    g_hash_table_insert(ttab, GUINT_TO_POINTER((unsigned int)tid), tmpl);
+    fbSessionTableInsert(ttab, tid, tmpl);
 
     if (internal &&
         tmpl->ie_internal_len > session->largestInternalTemplateLength)
@@ -1431,7 +1611,7 @@ gboolean        fbSessionRemoveTemplate(
     uint16_t        tid,
     GError          **err)
 {
-    GHashTable      *ttab = NULL;
+    fbTemplateTable_t *ttab = NULL;
     fbTemplate_t    *tmpl = NULL;
     gboolean        ok = TRUE;
 
@@ -1452,7 +1632,7 @@ gboolean        fbSessionRemoveTemplate(
     if (!internal)
         FB_SPREAD_MUTEX_LOCK(session);
 #endif
-    g_hash_table_remove(ttab, GUINT_TO_POINTER((unsigned int)tid));
+    fbSessionTableRemove(ttab, tid);
 
     if (internal) {
         session->intTmplTableChanged = TRUE;
@@ -1485,7 +1665,7 @@ fbTemplate_t    *fbSessionGetTemplate(
     uint16_t        tid,
     GError          **err)
 {
-    GHashTable      *ttab;
+    fbTemplateTable_t *ttab;
     fbTemplate_t    *tmpl;
 
     /* Select a template table to get the template from */
@@ -1495,7 +1675,7 @@ fbTemplate_t    *fbSessionGetTemplate(
     if (!internal)
         FB_SPREAD_MUTEX_LOCK(session);
 #endif
-    tmpl = g_hash_table_lookup(ttab, GUINT_TO_POINTER((unsigned int)tid));
+    tmpl = fbSessionTableLookup(ttab, tid);
 #if HAVE_SPREAD
     if (!internal)
         FB_SPREAD_MUTEX_UNLOCK(session);
@@ -1713,7 +1893,7 @@ gboolean        fbSessionExportTemplates(
                  * fbSessionGetTemplate which will try to acquire lock */
                 g_clear_error(&session->tdyn_err);
                 g_hash_table_foreach(
-                    session->ext_ttab,
+                    session->ext_ttab->hash,
                     (GHFunc)fbSessionExportOneTemplateMetadataRecord, session);
                 if (session->tdyn_err) {
                     g_propagate_error(&child_err, session->tdyn_err);
@@ -1733,7 +1913,7 @@ gboolean        fbSessionExportTemplates(
     FB_SPREAD_MUTEX_LOCK(session);
     if (session->ext_ttab) {
         g_clear_error(&session->tdyn_err);
-        g_hash_table_foreach(session->ext_ttab,
+        g_hash_table_foreach(session->ext_ttab->hash,
                              (GHFunc)fbSessionExportOneTemplate, session);
         if (session->tdyn_err) {
             g_propagate_error(err, session->tdyn_err);
@@ -1789,7 +1969,7 @@ fbSession_t     *fbSessionClone(
     session = fbSessionAlloc(base->model);
 
     /* Add each internal template from the base session to the new session */
-    g_hash_table_foreach(base->int_ttab,
+    g_hash_table_foreach(base->int_ttab->hash,
                          (GHFunc)fbSessionCloneOneTemplate, session);
 
     /* Need to copy over callbacks because in the UDP case we won't have
@@ -1798,6 +1978,13 @@ fbSession_t     *fbSessionClone(
     session->new_template_callback = base->new_template_callback;
     session->tmpl_app_ctx = base->tmpl_app_ctx;
 
+    /* Share the base session's template pairs; either session copies
+     * the table before changing it */
+    if (base->tmpl_pairs) {
+        g_atomic_int_inc(&base->tmpl_pairs->refcount);
+        session->tmpl_pairs = base->tmpl_pairs;
+    }
+
     /* copy collector reference */
     session->collector = base->collector;
 
@@ -1902,7 +2089,8 @@ static void fbSessionSetLargestInternalTemplateLen(
     if (!session || !session->int_ttab) {
         return;
     }
-    g_hash_table_foreach(session->int_ttab, fbSessionCheckTmplLengthForMax,
+    g_hash_table_foreach(session->int_ttab->hash,
+                         fbSessionCheckTmplLengthForMax,
                          session);
 }
 
@@ -270,57 +270,7 @@ static fbInfoElementSpec_t sflow_spec[] = {
     FB_IESPEC_NULL
 };
 
-typedef struct fbSFlowRecord_st{
-    /* IPv6 or raw packet data */
-    uint8_t               sourceIPv6Address[16];
-    uint8_t               destinationIPv6Address[16];
-    /* extended router data */
-    uint8_t               nextHopIPv6Address[16];
-    /* extended gateway data */
-    uint8_t               bgpNextHopIPv6Address[16];
-    /* flow header data */
-    uint8_t               collectorIPv6Address[16];
-    uint64_t              collectionTimeMilliseconds;
-    uint64_t              systemUpTime;
-    uint32_t              collectorIPv4Address;
-    /* IPv4/6 data or raw packet data */
-    uint8_t               protocolIdentifier;
-    uint8_t               ipClassOfService;
-    /* format 1002 next hop src/dst mask */
-    uint8_t               sourceIPv4PrefixLength;
-    uint8_t               destinationIPv4PrefixLength;
-    /* IPv4 or raw packet data */
-    uint32_t              sourceIPv4Address;
-    uint32_t              destinationIPv4Address;
-    /* flow header data */
-    uint32_t              octetTotalCount;
-    uint32_t              packetTotalCount;
-    uint32_t              ingressInterface;
-    uint32_t              egressInterface;
-    /* ethernet frame data, ip, or raw packet data */
-    uint8_t               sourceMacAddress[6];
-    uint8_t               destinationMacAddress[6];
-    /* extended router data */
-    uint32_t              nextHopIPv4Address;
-    /* extended gateway data */
-    uint32_t              bgpSourceAsNumber;
-    uint32_t              bgpDestinationAsNumber;
-    uint32_t              bgpNextHopIPv4Address;
-    /* flow sample fields */
-    uint32_t              samplingPacketInterval;
-    uint32_t              samplingPopulation;
-    uint32_t              droppedPacketTotalCount;
-    uint32_t              selectorId;
-    /* IPv4/6 data or raw packet data */
-    uint16_t              vlanId;
-    uint16_t              sourceTransportPort;
-    uint16_t              destinationTransportPort;
-    uint16_t              tcpControlBits;
-    /* extended switch data */
-    uint16_t              dot1qVlanId;
-    uint16_t              postDot1qVlanId;
-    uint8_t               dot1qPriority;
-} fbSFlowRecord_t;
+/* fbSFlowRecord_t is defined in public.h */
 
 static fbInfoElementSpec_t sflow_ctr_spec[] = {
     { (char *)"collectorIPv6Address",             16, 0 },
@@ -343,25 +293,7 @@ static fbInfoElementSpec_t sflow_ctr_spec[] = {
     FB_IESPEC_NULL
 };
 
-typedef struct fbSFlowCounterRecord_st {
-    uint8_t          ipv6[16];
-    uint64_t         ctime;
-    uint64_t         sysuptime;
-    uint32_t         ipv4;
-    uint32_t         ingress;
-    uint64_t         inoct;
-    uint32_t         ingressType;
-    uint32_t         inpkt;
-    uint32_t         inmulti;
-    uint32_t         inbroad;
-    uint32_t         indiscard;
-    uint32_t         inerr;
-    uint64_t         outoct;
-    uint32_t         inunknown;
-    uint32_t         outpkt;
-    uint32_t         outbroad;
-    uint32_t         agentid;
-} fbSFlowCounterRecord_t;
+/* fbSFlowCounterRecord_t is defined in public.h */
 
 
 
@@ -445,8 +377,14 @@ struct fbCollectorSFlowState_st {
     fbSession_t                   *cosession;
     fbInfoModel_t                 *model;
     fBuf_t                        *fbuf;
+    /** buffer exporter writing to ipfixBuffer; owned by fbuf */
+    fbExporter_t                  *exporter;
     uint8_t                       *ipfixBuffer;
     GHashTable                    *domainHash;
+    /** optional callbacks receiving samples instead of the fbuf */
+    fbCollectorSFlowFlow_fn       flow_fn;
+    fbCollectorSFlowCounter_fn    counter_fn;
+    void                          *cb_ctx;
     pthread_mutex_t               ts_lock;
 };
 
@@ -458,6 +396,15 @@ static void         sessionDestroyHelper(
 }
 
 
+/**
+ * sflowAppendRec
+ *
+ * hands a flow sample to the flow callback, or appends it to the IPFIX
+ * buffer.  The caller holds ts_lock; it is released while the callback
+ * runs so that the callback may call fbCollectorGetSFlowMissed() and the
+ * other functions that take it.
+ *
+ */
 static gboolean sflowAppendRec(
     fbCollector_t *collector,
     fbSFlowRecord_t *sflowrec,
@@ -465,6 +412,16 @@ static gboolean sflowAppendRec(
 {
     struct fbCollectorSFlowState_st     *transState =
         (struct fbCollectorSFlowState_st *)collector->translatorState;
+    fbCollectorSFlowFlow_fn             flow_fn = transState->flow_fn;
+    void                                *ctx = transState->cb_ctx;
+    gboolean                            rv;
+
+    if (flow_fn) {
+        pthread_mutex_unlock(&transState->ts_lock);
+        rv = flow_fn(collector, sflowrec, ctx, err);
+        pthread_mutex_lock(&transState->ts_lock);
+        return rv;
+    }
 
     /* appending new record */
 
@@ -482,6 +439,14 @@ static gboolean sflowAppendRec(
     return TRUE;
 }
 
+/**
+ * sflowAppendOptRec
+ *
+ * hands a counter sample to the counter callback, or appends it to the
+ * IPFIX buffer.  As in sflowAppendRec(), ts_lock is released while the
+ * callback runs.
+ *
+ */
 static gboolean sflowAppendOptRec(
     fbCollector_t           *collector,
     fbSFlowCounterRecord_t  *sflowrec,
@@ -489,6 +454,16 @@ static gboolean sflowAppendOptRec(
 {
     struct fbCollectorSFlowState_st     *transState =
         (struct fbCollectorSFlowState_st *)collector->translatorState;
+    fbCollectorSFlowCounter_fn          counter_fn = transState->counter_fn;
+    void                                *ctx = transState->cb_ctx;
+    gboolean                            rv;
+
+    if (counter_fn) {
+        pthread_mutex_unlock(&transState->ts_lock);
+        rv = counter_fn(collector, sflowrec, ctx, err);
+        pthread_mutex_lock(&transState->ts_lock);
+        return rv;
+    }
 
     /* appending new record */
 
@@ -516,29 +491,47 @@ static gboolean sflowAppendOptRec(
 
 
 
-static fbExporter_t *sflowAllocExporter(
-    uint8_t      *dataBuf,
-    fBuf_t       *fbuf,
-    GError       **err)
+/**
+ * sflowStartMessage
+ *
+ * Prepares the translator's fBuf for the IPFIX message built from the
+ * next sFlow datagram.  The fBuf and its buffer exporter are created on
+ * first use and kept for the life of the translator, so each datagram
+ * only costs a close and a rewind.  Records left from a datagram that
+ * failed to translate are discarded.
+ *
+ * @param transState the sFlow translator state
+ * @param newbuffer  set to TRUE if the fBuf was just created
+ * @param err        glib error set when FALSE is returned
+ *
+ * @return TRUE on success FALSE on error
+ */
+static gboolean sflowStartMessage(
+    struct fbCollectorSFlowState_st *transState,
+    gboolean                        *newbuffer,
+    GError                          **err)
 {
-    fbExporter_t *exp = NULL;
-
-    exp = fbExporterAllocBuffer(dataBuf, 65496);
-
-    if (fbuf) {
-        fBufSetExporter(fbuf, exp);
-
-        if (!fBufSetInternalTemplate(fbuf, SFLOW_TID, err)) {
-            return NULL;
-        }
+    if (!transState->fbuf) {
+        transState->exporter = fbExporterAllocBuffer(transState->ipfixBuffer,
+                                                     65496);
+        transState->fbuf = fBufAllocForExport(transState->exsession,
+                                              transState->exporter);
+        *newbuffer = TRUE;
+    } else {
+        /* forget the previous message so an empty one is not resent */
+        fbExporterClose(transState->exporter);
+        fBufRewind(transState->fbuf);
+    }
 
-        if (!fBufSetExportTemplate(fbuf, SFLOW_TID, err)) {
-            return NULL;
-        }
+    if (!fBufSetInternalTemplate(transState->fbuf, SFLOW_TID, err)) {
+        return FALSE;
     }
 
-    return exp;
+    if (!fBufSetExportTemplate(transState->fbuf, SFLOW_TID, err)) {
+        return FALSE;
+    }
 
+    return TRUE;
 }
 
 
@@ -1257,6 +1250,34 @@ static int sflowCounterSampleParse(
 
 
 
+/**
+ * sflowSessionLookup
+ *
+ * returns the sequence number state of an sFlow session, creating it and
+ * setting newbuffer if it is new.  The caller holds ts_lock.
+ *
+ */
+static fbCollectorSFlowSession_t *sflowSessionLookup(
+    struct fbCollectorSFlowState_st *transState,
+    fbSession_t                     *session,
+    gboolean                        *newbuffer)
+{
+    if (transState->cosession != session) {
+        /* lookup template Hash Table per Domain */
+        transState->session =
+            g_hash_table_lookup(transState->domainHash, session);
+        if (transState->session == NULL) {
+            transState->session = g_slice_new0(fbCollectorSFlowSession_t);
+            g_hash_table_insert(transState->domainHash, (gpointer)session,
+                                transState->session);
+            *newbuffer = TRUE;
+        }
+        transState->cosession = session;
+    }
+
+    return transState->session;
+}
+
 /**
  * fbCollectorPostProcSFlow
  *
@@ -1281,7 +1302,6 @@ static gboolean     fbCollectorPostProcSFlow(
     int               flows = 0;
     int               counters = 0;
     uint8_t           *msgOsetPtr = dataBuf;
-    fbExporter_t      *sfexp = NULL;
     size_t            msgParsed = *bufLen;
     uint32_t          sflowSeqNum;
     uint32_t          innerSeqNum;
@@ -1307,17 +1327,7 @@ static gboolean     fbCollectorPostProcSFlow(
 
     pthread_mutex_lock(&transState->ts_lock);
 
-    memset(transState->ipfixBuffer, 0, 65535);
-
-    if (!transState->fbuf) {
-
-        transState->fbuf = fBufAllocForExport(transState->exsession, NULL);
-
-        newbuffer = TRUE;
-    }
-
-    sfexp = sflowAllocExporter(transState->ipfixBuffer, transState->fbuf, err);
-    if (!sfexp) {
+    if (!sflowStartMessage(transState, &newbuffer, err)) {
         pthread_mutex_unlock(&transState->ts_lock);
         return FALSE;
     }
@@ -1344,26 +1354,14 @@ static gboolean     fbCollectorPostProcSFlow(
     fprintf(stderr, "Sequence number %u\n", sflowSeqNum);
 #endif
 
-    if (transState->cosession != collector->udp_head->session) {
-        /* lookup template Hash Table per Domain */
-        transState->session =
-            g_hash_table_lookup(transState->domainHash,
-                                collector->udp_head->session);
-        if (transState->session == NULL) {
-            transState->session = g_slice_new0(fbCollectorSFlowSession_t);
-            g_hash_table_insert(transState->domainHash,
-                                (gpointer)collector->udp_head->session,
-                                transState->session);
-            newbuffer = TRUE;
-        }
-        transState->cosession = collector->udp_head->session;
-    }
-
-    currentSession = transState->session;
+    currentSession = sflowSessionLookup(transState,
+                                        collector->udp_head->session,
+                                        &newbuffer);
     transState->observation_id = obsDomain;
 
 
-    if (newbuffer) {
+    /* templates are only needed when some samples are exported as IPFIX */
+    if (newbuffer && !(transState->flow_fn && transState->counter_fn)) {
 
         if (!fbSessionExportTemplates(transState->exsession, err)) {
             pthread_mutex_unlock(&transState->ts_lock);
@@ -1373,7 +1371,7 @@ static gboolean     fbCollectorPostProcSFlow(
         /*fBufSetAutomaticMode(transState->fbuf, FALSE);*/
         fBufEmit(transState->fbuf, err);
         g_clear_error(err);
-        msglen = fbExporterGetMsgLen(sfexp);
+        msglen = fbExporterGetMsgLen(transState->exporter);
 
 #if FB_SFLOW_DEBUG == 1
         fprintf(stderr, "EXPORTED TEMPLATES %u\n", msglen);
@@ -1515,7 +1513,6 @@ static gboolean     fbCollectorPostProcSFlow(
             /* Flow Sample */
             flows = sflowFlowSampleParse(collector, &msgOsetPtr, &msgParsed,
                                          &sflowrec, FALSE, err);
-            currentSession->sflowFlowSeqNum++;
             break;
           case 2:
             sflowctr.agentid = obsDomain;
@@ -1528,12 +1525,10 @@ static gboolean     fbCollectorPostProcSFlow(
             }
             counters = sflowCounterSampleParse(collector, &msgOsetPtr, &msgParsed,
                                                &sflowctr, FALSE, err);
-            currentSession->sflowCounterSeqNum++;
             break;
           case 3:
             flows = sflowFlowSampleParse(collector, &msgOsetPtr, &msgParsed,
                                          &sflowrec, TRUE, err);
-            currentSession->sflowFlowSeqNum++;
             break;
           case 4:
             sflowctr.agentid = obsDomain;
@@ -1546,7 +1541,6 @@ static gboolean     fbCollectorPostProcSFlow(
             }
             counters = sflowCounterSampleParse(collector, &msgOsetPtr, &msgParsed,
                                                &sflowctr, TRUE, err);
-            currentSession->sflowCounterSeqNum++;
             break;
           default:
             g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_SFLOW,
@@ -1556,6 +1550,17 @@ static gboolean     fbCollectorPostProcSFlow(
             return FALSE;
         }
 
+        /* the sample callbacks run without ts_lock, during which the
+           session may have timed out */
+        currentSession = sflowSessionLookup(transState,
+                                            collector->udp_head->session,
+                                            &newbuffer);
+        if (format == 1 || format == 3) {
+            currentSession->sflowFlowSeqNum++;
+        } else {
+            currentSession->sflowCounterSeqNum++;
+        }
+
         if (!flows && !counters) {
             /* error ocurred */
             currentSession->sflowSeqNum++;
@@ -1585,13 +1590,11 @@ static gboolean     fbCollectorPostProcSFlow(
     fBufEmit(transState->fbuf, err);
     g_clear_error(err);
 
-    msglen = fbExporterGetMsgLen(sfexp);
+    msglen = fbExporterGetMsgLen(transState->exporter);
 
     memcpy(dataBuf, transState->ipfixBuffer, msglen);
     *bufLen = msglen;
 
-    fbExporterClose(sfexp);
-
     pthread_mutex_unlock(&transState->ts_lock);
 
     return TRUE;
@@ -1788,6 +1791,50 @@ gboolean    fbCollectorSetSFlowTranslator(
 
 
 
+/**
+ * fbCollectorSetSFlowCallbacks
+ *
+ * sets the callbacks that receive decoded sFlow samples in place of
+ * the IPFIX records the translator would otherwise build
+ *
+ * @param collector pointer to a collector with the SFlow translator set
+ * @param flow_fn callback for flow samples, or NULL
+ * @param counter_fn callback for counter samples, or NULL
+ * @param ctx context pointer passed to the callbacks
+ * @param err GError structure that holds the error
+ *        message if an error occurs
+ *
+ * @return TRUE on success, FALSE on error
+ */
+gboolean    fbCollectorSetSFlowCallbacks(
+    fbCollector_t               *collector,
+    fbCollectorSFlowFlow_fn     flow_fn,
+    fbCollectorSFlowCounter_fn  counter_fn,
+    void                        *ctx,
+    GError                      **err)
+{
+    struct fbCollectorSFlowState_st     *transState = NULL;
+
+    if (collector->copostRead != fbCollectorPostProcSFlow) {
+        g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_IMPL,
+                    "Collector does not have the sFlow translator set");
+        return FALSE;
+    }
+
+    transState = (struct fbCollectorSFlowState_st *)collector->translatorState;
+
+    pthread_mutex_lock(&transState->ts_lock);
+    transState->flow_fn = flow_fn;
+    transState->counter_fn = counter_fn;
+    transState->cb_ctx = ctx;
+    pthread_mutex_unlock(&transState->ts_lock);
+
+    return TRUE;
+}
+
+
+
+
 /**
  * fbCollectorGetSFlowMissed
  *
@@ -74,9 +74,6 @@ fbTemplate_t        *fbTemplateAlloc(
     tmpl->tmpl_len = 4;
     tmpl->active = FALSE;
 
-    /* allocate indices table */
-    tmpl->indices = g_hash_table_new((GHashFunc)fbInfoElementHash,
-                                     (GEqualFunc)fbInfoElementEqual);
     return tmpl;
 }
 
@@ -113,8 +110,8 @@ void                fbTemplateFree(
     if (tmpl->ctx_free) {
         tmpl->ctx_free(tmpl->tmpl_ctx, tmpl->app_ctx);
     }
-    /* destroy index table if present */
-    if (tmpl->indices) g_hash_table_destroy(tmpl->indices);
+    /* destroy index */
+    g_free(tmpl->indices);
 
     /* destroy IE array */
     for (i = 0; i < tmpl->ie_count; i++) {
@@ -150,14 +147,55 @@ static fbInfoElement_t *fbTemplateExtendElements(
     return tmpl->ie_ary[tmpl->ie_count - 1];
 }
 
+/**
+ *    Returns the position in the index of `tmpl` of the first entry
+ *    whose key is not less than `key`.
+ */
+static uint16_t fbTemplateIndexLowerBound(
+    const fbTemplate_t  *tmpl,
+    uint64_t             key)
+{
+    uint16_t            lo = 0;
+    uint16_t            hi = tmpl->index_count;
+    uint16_t            mid;
+
+    while (lo < hi) {
+        mid = lo + (hi - lo) / 2;
+        if (tmpl->indices[mid].key < key) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+gboolean            fbTemplateFindIndex(
+    const fbTemplate_t      *tmpl,
+    const fbInfoElement_t   *ie,
+    uint16_t                *index)
+{
+    uint64_t            key = FB_TMPL_INDEX_KEY(ie);
+    uint16_t            i = fbTemplateIndexLowerBound(tmpl, key);
+
+    if (i == tmpl->index_count || tmpl->indices[i].key != key) {
+        return FALSE;
+    }
+    if (index) {
+        *index = tmpl->indices[i].pos;
+    }
+    return TRUE;
+}
+
 static void     fbTemplateExtendIndices(
     fbTemplate_t        *tmpl,
     fbInfoElement_t     *tmpl_ie)
 {
-    void                *ign0, *ign1;
+    uint64_t            key;
+    uint16_t            i;
 
-    /* search indices table for multiple IE index */
-    while (g_hash_table_lookup_extended(tmpl->indices, tmpl_ie, &ign0, &ign1)) {
+    /* search index for multiple IE index */
+    while (fbTemplateFindIndex(tmpl, tmpl_ie, NULL)) {
         ++(tmpl_ie->midx);
     }
 
@@ -180,9 +218,16 @@ static void     fbTemplateExtendIndices(
         tmpl->ie_internal_len += tmpl_ie->len;
     }
 
-    /* Add index of this information element to the indices table */
-    g_hash_table_insert(tmpl->indices, tmpl_ie,
-                        GUINT_TO_POINTER(tmpl->ie_count - 1));
+    /* Insert this information element into the index in key order */
+    key = FB_TMPL_INDEX_KEY(tmpl_ie);
+    i = fbTemplateIndexLowerBound(tmpl, key);
+    tmpl->indices = g_renew(fbTemplateIndex_t, tmpl->indices,
+                            tmpl->index_count + 1);
+    memmove(&tmpl->indices[i + 1], &tmpl->indices[i],
+            (tmpl->index_count - i) * sizeof(fbTemplateIndex_t));
+    tmpl->indices[i].key = key;
+    tmpl->indices[i].pos = tmpl->ie_count - 1;
+    ++(tmpl->index_count);
 }
 
 gboolean            fbTemplateAppend(
@@ -278,17 +323,11 @@ gboolean           fbTemplateContainsElement(
     fbTemplate_t            *tmpl,
     const fbInfoElement_t   *ex_ie)
 {
-    int i;
-
     if ( ex_ie == NULL || tmpl == NULL ) {
         return FALSE;
     }
 
-    for (i = 0; i < tmpl->ie_count; i++) {
-        if (fbInfoElementEqual(ex_ie, tmpl->ie_ary[i])) return TRUE;
-    }
-
-    return FALSE;
+    return fbTemplateFindIndex(tmpl, ex_ie, NULL);
 }
 
 gboolean           fbTemplateContainsElementByName(
@@ -41,11 +41,23 @@
 
 #define _FIXBUF_SOURCE_
 #include <fixbuf/private.h>
+#include <pthread.h>
 
 
 #define FB_MTU_MIN              32
 #define FB_TCPLAN_NULL          -1
+#define FB_TCPLAN_TABLE_MIN     16
+#define FB_LIST_ARENA_ALIGN     8
+#define FB_LIST_ARENA_HDR                                               \
+    ((sizeof(fbListArenaBlock_t) + FB_LIST_ARENA_ALIGN - 1)             \
+     & ~(size_t)(FB_LIST_ARENA_ALIGN - 1))
 #define FB_MAX_TEMPLATE_LEVELS  10
+/** log2 of the size of the smallest message buffer size class */
+#define FB_MSGBUF_MIN_SHIFT     9
+/** Number of message buffer size classes: 512 octets to 64 KiB */
+#define FB_MSGBUF_CLASSES       8
+/** Number of free message buffers the pool keeps per size class */
+#define FB_MSGBUF_POOL_DEPTH    16
 
 /* Debugger switches. We'll want to stick these in autoinc at some point. */
 #define FB_DEBUG_TC         0
@@ -55,167 +67,135 @@
 #define FB_DEBUG_LWR        0
 #define FB_DEBUG_LRD        0
 
+/**
+ * Operation codes for the instructions in a compiled transcode plan.
+ */
+typedef enum fbTranscodeOpCode_en {
+    /** Copy `d_len` bytes verbatim from the source */
+    FB_TCOP_COPY,
+    /** Copy `count` fields of `s_len` bytes each, reversing each field */
+    FB_TCOP_SWAP,
+    /** Write `d_len` zero bytes; the destination has no source element */
+    FB_TCOP_ZERO,
+    /** Fixed-length element whose source and destination sizes differ */
+    FB_TCOP_FIXED,
+    /** Variable-length octet array or string */
+    FB_TCOP_VARFIELD,
+    /** basicList */
+    FB_TCOP_BASICLIST,
+    /** subTemplateList */
+    FB_TCOP_SUBTMPLLIST,
+    /** subTemplateMultiList */
+    FB_TCOP_SUBTMPLMULTILIST,
+    /** Fixed-length to variable-length or vice versa; unsupported */
+    FB_TCOP_MISMATCH
+} fbTranscodeOpCode_t;
+
+/**
+ * A single instruction of a compiled transcode plan.  Adjacent
+ * destination elements whose source elements are also adjacent are
+ * merged into a single COPY or SWAP instruction, and adjacent
+ * destination elements with no source are merged into a single ZERO.
+ */
+typedef struct fbTranscodeOp_st {
+    /** The fbTranscodeOpCode_t of this instruction */
+    uint8_t         code;
+    /** Number of source elements covered by this instruction */
+    uint16_t        count;
+    /** Index of the first source element; unused for ZERO */
+    uint16_t        si;
+    /** Length of each source element */
+    uint16_t        s_len;
+    /** Total number of destination octets written (fixed ops only) */
+    uint32_t        d_len;
+    /** Flags of the destination element */
+    uint32_t        flags;
+} fbTranscodeOp_t;
+
 typedef struct fbTranscodePlan_st {
     fbTemplate_t    *s_tmpl;
     fbTemplate_t    *d_tmpl;
     int32_t         *si;
+    /** The compiled instructions; NULL until first used, and for a
+     *  destination template with no elements */
+    fbTranscodeOp_t *ops;
+    /** Number of entries in `ops` */
+    uint16_t        op_count;
+    /** Whether `ops` has been compiled */
+    gboolean        compiled;
+    /** Whether `ops` was compiled for decode (TRUE) or encode (FALSE) */
+    gboolean        decode;
 } fbTranscodePlan_t;
 
-typedef struct fbDLL_st fbDLL_t;
-
-struct fbDLL_st {
-    fbDLL_t *next;
-    fbDLL_t *prev;
-};
-
-typedef struct fbTCPlanEntry_st fbTCPlanEntry_t;
-struct fbTCPlanEntry_st
-{
-    fbTCPlanEntry_t *next;
-    fbTCPlanEntry_t *prev;
-    fbTranscodePlan_t  *tcplan;
-};
-
 /**
- *detachHeadOfDLL
- *
- * takes the head off of the dynamic linked list
- *
- * @param head
- * @param tail
- * @param toRemove
- *
- *
+ * Open-addressed table of the transcode plans of a buffer, keyed on the
+ * (source, destination) template pointer pair, with linear probing.
+ * `memo` is the plan returned by the most recent lookup, which is checked
+ * first since consecutive records usually share their templates.
  */
-static void detachHeadOfDLL(
-    fbDLL_t **head,
-    fbDLL_t **tail,
-    fbDLL_t **toRemove)
-{
-    /*  assign the out pointer to the head */
-    *toRemove = *head;
-    /*  move the head pointer to pointer to the next element*/
-    *head = (*head)->next;
-
-    /*  if the new head's not NULL, set its prev to NULL */
-    if (*head) {
-        (*head)->prev = NULL;
-    } else {
-        /*  if it's NULL, it means there are no more elements, if
-         *  there's a tail pointer, set it to NULL too */
-        if (tail) {
-            *tail = NULL;
-        }
-    }
-}
+typedef struct fbTCPlanTable_st {
+    /** Array of `size` slots; NULL marks an empty slot */
+    fbTranscodePlan_t  **slots;
+    /** Number of slots; zero or a power of two */
+    uint32_t            size;
+    /** Number of plans in the table */
+    uint32_t            count;
+    /** Plan returned by the last lookup, or NULL */
+    fbTranscodePlan_t  *memo;
+    /** Number of lookups satisfied by an existing plan */
+    uint64_t            hits;
+    /** Number of lookups that had to build a new plan */
+    uint64_t            misses;
+} fbTCPlanTable_t;
 
 /**
- *attachHeadToDLL
- *
- * puts a new element to the head of the dynamic linked list
- *
- * @param head
- * @param tail
- * @param newEntry
- *
+ * Result of the internal single record/set read and append functions.
+ * Reaching the end of a message is normal control flow in automatic mode,
+ * so it is reported as a status instead of allocating an FB_ERROR_EOM
+ * GError that the caller would immediately clear.
  */
-static void attachHeadToDLL(
-    fbDLL_t **head,
-    fbDLL_t **tail,
-    fbDLL_t  *newEntry)
-{
-    /*  if this is NOT the first entry in the list */
-    if (*head) {
-        /*  typical linked list attachements */
-        newEntry->next = *head;
-        newEntry->prev = NULL;
-        (*head)->prev = newEntry;
-        *head = newEntry;
-    } else {
-        /*  the new entry is the only entry now, set head to it */
-        *head = newEntry;
-        newEntry->prev = NULL;
-        newEntry->next = NULL;
-        /*  if we're keeping track of tail, assign that too */
-        if (tail) {
-            *tail = newEntry;
-        }
-    }
-}
+typedef enum fBufStatus_en {
+    /** Success */
+    FB_STATUS_OK,
+    /** End of message; the GError was not set */
+    FB_STATUS_EOM,
+    /** Failure; the GError was set, possibly to FB_ERROR_EOM */
+    FB_STATUS_ERROR
+} fBufStatus_t;
 
 /**
- *moveThisEntryToHeadOfDLL
- *
- * moves an entry within the dynamically linked list to the head of the list
- *
- * @param head - the head of the dynamic linked list
- * @param tail - unused
- * @param thisEntry - list element to move to the head
- *
+ * A growable array of transcoder field offsets.
  */
-static void moveThisEntryToHeadOfDLL(
-    fbDLL_t **head,
-    fbDLL_t **tail __attribute__((unused)),
-    fbDLL_t  *thisEntry)
-{
-    if (thisEntry == *head) {
-        return;
-    }
-
-    if (thisEntry->prev) {
-        thisEntry->prev->next = thisEntry->next;
-    }
-
-    if (thisEntry->next) {
-        thisEntry->next->prev = thisEntry->prev;
-    }
-
-    thisEntry->prev = NULL;
-    thisEntry->next = *head;
-    (*head)->prev = thisEntry;
-    *head = thisEntry;
-}
+typedef struct fbOffsetScratch_st {
+    /** The offsets */
+    uint16_t            *offsets;
+    /** Number of entries allocated in `offsets` */
+    uint32_t            count;
+} fbOffsetScratch_t;
 
 /**
- *detachThisEntryOfDLL
- *
- * removes an entry from the dynamically linked list
- *
- * @param head
- * @param tail
- * @param entry
- *
+ * A free message buffer in the message buffer pool.  The link is
+ * stored in the buffer's own storage.
  */
-static void detachThisEntryOfDLL(
-    fbDLL_t **head,
-    fbDLL_t **tail,
-    fbDLL_t  *entry)
-{
-    /*  entry already points to the entry to remove, so we're good
-     *  there */
-    /*  if it's NOT the head of the list, patch up entry->prev */
-    if (entry->prev != NULL) {
-        entry->prev->next = entry->next;
-    } else {
-        /*  if it's the head, reassign the head */
-        *head = entry->next;
-    }
-    /*  if it's NOT the tail of the list, patch up entry->next */
-    if (entry->next != NULL) {
-        entry->next->prev = entry->prev;
-    } else {
-        /*  it is the last entry in the list, if we're tracking the
-         *  tail, reassign */
-        if (tail) {
-            *tail = entry->prev;
-        }
-    }
+typedef struct fbMsgBufFree_st fbMsgBufFree_t;
+struct fbMsgBufFree_st {
+    /** Next free buffer of the same size class */
+    fbMsgBufFree_t      *next;
+};
 
-    /*  finish detaching by setting the next and prev pointers to
-     *  null */
-    entry->prev = NULL;
-    entry->next = NULL;
-}
+/**
+ * A block of the list arena of a buffer.  The storage follows the
+ * header, at offset FB_LIST_ARENA_HDR.
+ */
+typedef struct fbListArenaBlock_st fbListArenaBlock_t;
+struct fbListArenaBlock_st {
+    /** Next (older) block */
+    fbListArenaBlock_t  *next;
+    /** Number of bytes of storage in the block */
+    size_t              size;
+    /** Number of bytes of storage handed out */
+    size_t              used;
+};
 
 struct fBuf_st {
     /** Transport session. Contains template and sequence number state. */
@@ -224,8 +204,8 @@ struct fBuf_st {
     fbExporter_t        *exporter;
     /** Collector. Reads messages from a remote endpoint on demand. */
     fbCollector_t       *collector;
-    /** Cached transcoder plan */
-    fbTCPlanEntry_t    *latestTcplan;
+    /** Cached transcoder plans */
+    fbTCPlanTable_t     tcplans;
     /** Current internal template. */
     fbTemplate_t        *int_tmpl;
     /** Current external template. */
@@ -271,10 +251,48 @@ struct fBuf_st {
      * Valid only after a call to fBufNextSetHeader() (called by fBufNext()).
      */
     uint8_t             *sep;
-    /** Message buffer. */
-    uint8_t             buf[FB_MSGLEN_MAX+1];
+    /**
+     * Scratch arrays for the field offsets of variable-length records,
+     * one per nesting level of list transcoding.
+     */
+    fbOffsetScratch_t   *off_scratch;
+    /** Number of entries in off_scratch */
+    uint32_t            off_levels;
+    /** Current nesting level; index of the next free off_scratch entry */
+    uint32_t            off_depth;
+    /**
+     * Field offsets of the last record returned by fBufNextView(), if
+     * its template is variable-length.
+     */
+    uint16_t            *view_offsets;
+    /** Number of entries allocated in view_offsets */
+    uint32_t            view_offsets_len;
+    /**
+     * List arena blocks, most recent first. List content decoded while
+     * the arena is enabled is allocated from these blocks.
+     */
+    fbListArenaBlock_t  *arena;
+    /** Minimum size of a list arena block; 0 if the arena is disabled */
+    size_t              arena_block_size;
+    /**
+     * Message buffer, borrowed from the message buffer pool while a
+     * message is being written or read.  A collector borrows one of the
+     * size class of the message once its header has been read, and
+     * returns it at end of message.  NULL between messages, and when
+     * reading from a mapped file or an application buffer.
+     */
+    uint8_t             *buf;
+    /** Size class of buf */
+    unsigned int        buf_class;
 };
 
+/** Protects the message buffer pool */
+static pthread_mutex_t  fbMsgBufPoolLock = PTHREAD_MUTEX_INITIALIZER;
+/** Free message buffers, by size class */
+static fbMsgBufFree_t   *fbMsgBufPoolFree[FB_MSGBUF_CLASSES];
+/** Number of buffers in each fbMsgBufPoolFree list */
+static unsigned int     fbMsgBufPoolCount[FB_MSGBUF_CLASSES];
+
 int transcodeCount = 0;
 /*==================================================================
  *
@@ -360,6 +378,12 @@ static void fBufDebugTranscodePlan(
     for (i = 0; i < tcplan->d_tmpl->ie_count; i++) {
         fprintf(stderr, "\td[%2u]=s[%2d]\n", i, tcplan->si[i]);
     }
+    for (i = 0; i < tcplan->op_count; i++) {
+        fprintf(stderr, "\top[%2u] code %u si %2u count %2u s_len %4u"
+                " d_len %4u\n", i, tcplan->ops[i].code, tcplan->ops[i].si,
+                tcplan->ops[i].count, tcplan->ops[i].s_len,
+                tcplan->ops[i].d_len);
+    }
 }
 
 static void fBufDebugTranscodeOffsets(
@@ -427,6 +451,129 @@ static void fBufDebugBuffer(
 #define FB_TC_DBC_ERR(_need_, _op_)             \
     FB_TC_DBC_DEST((_need_), (_op_), goto err)
 
+/**
+ * fbTranscodePlanFree
+ *
+ * @param tcplan
+ *
+ */
+static void fbTranscodePlanFree(
+    fbTranscodePlan_t      *tcplan)
+{
+    g_free(tcplan->si);
+    g_free(tcplan->ops);
+    g_slice_free1(sizeof(fbTranscodePlan_t), tcplan);
+}
+
+/**
+ * fbTCPlanTableSlot
+ *
+ * Returns the index of the slot holding the plan for the given template
+ * pair, or of the empty slot where it would be inserted.  The table must
+ * have at least one empty slot.
+ *
+ * @param table
+ * @param s_tmpl
+ * @param d_tmpl
+ *
+ */
+static uint32_t fbTCPlanTableSlot(
+    const fbTCPlanTable_t  *table,
+    const fbTemplate_t     *s_tmpl,
+    const fbTemplate_t     *d_tmpl)
+{
+    fbTranscodePlan_t      *tcplan;
+    uint64_t                h;
+    uint32_t                mask = table->size - 1;
+    uint32_t                i;
+
+    /* mix both pointers; their low bits carry little information */
+    h = (uint64_t)GPOINTER_TO_SIZE(s_tmpl) * UINT64_C(0x9E3779B97F4A7C15);
+    h ^= (uint64_t)GPOINTER_TO_SIZE(d_tmpl) + (h >> 29);
+    h *= UINT64_C(0xBF58476D1CE4E5B9);
+
+    for (i = (uint32_t)(h >> 32) & mask; ; i = (i + 1) & mask) {
+        tcplan = table->slots[i];
+        if (!tcplan ||
+            (tcplan->s_tmpl == s_tmpl && tcplan->d_tmpl == d_tmpl))
+        {
+            return i;
+        }
+    }
+}
+
+/**
+ * fbTCPlanTableResize
+ *
+ * Rehashes the plans of `table` into `size` slots.
+ *
+ * @param table
+ * @param size
+ *
+ */
+static void fbTCPlanTableResize(
+    fbTCPlanTable_t        *table,
+    uint32_t                size)
+{
+    fbTranscodePlan_t     **old_slots = table->slots;
+    fbTranscodePlan_t      *tcplan;
+    uint32_t                old_size = table->size;
+    uint32_t                i;
+
+    table->slots = g_new0(fbTranscodePlan_t *, size);
+    table->size = size;
+
+    for (i = 0; i < old_size; i++) {
+        if ((tcplan = old_slots[i])) {
+            table->slots[fbTCPlanTableSlot(table, tcplan->s_tmpl,
+                                           tcplan->d_tmpl)] = tcplan;
+        }
+    }
+
+    g_free(old_slots);
+}
+
+/**
+ * fbTCPlanTableClear
+ *
+ * Frees every plan in `table` for which `tmpl` is the source or the
+ * destination template, or every plan when `tmpl` is NULL.
+ *
+ * @param table
+ * @param tmpl
+ *
+ */
+static void fbTCPlanTableClear(
+    fbTCPlanTable_t        *table,
+    const fbTemplate_t     *tmpl)
+{
+    fbTranscodePlan_t      *tcplan;
+    uint32_t                i;
+
+    for (i = 0; i < table->size; i++) {
+        tcplan = table->slots[i];
+        if (tcplan &&
+            (!tmpl || tcplan->s_tmpl == tmpl || tcplan->d_tmpl == tmpl))
+        {
+            if (tcplan == table->memo) {
+                table->memo = NULL;
+            }
+            fbTranscodePlanFree(tcplan);
+            table->slots[i] = NULL;
+            --(table->count);
+        }
+    }
+
+    if (!tmpl) {
+        g_free(table->slots);
+        table->slots = NULL;
+        table->size = 0;
+    } else if (table->count) {
+        /* close the gaps left in the probe sequences */
+        fbTCPlanTableResize(table, table->size);
+    }
+}
+
 /**
  * fbTranscodePlan
  *
@@ -441,69 +588,141 @@ static fbTranscodePlan_t *fbTranscodePlan(
     fbTemplate_t            *s_tmpl,
     fbTemplate_t            *d_tmpl)
 {
-    void                   *sik, *siv;
-    uint32_t                i;
-    fbTCPlanEntry_t        *entry;
+    fbTCPlanTable_t        *table = &fbuf->tcplans;
+    uint32_t                i, j, slot;
     fbTranscodePlan_t      *tcplan;
 
+    /* check the plan used for the previous record */
+    tcplan = table->memo;
+    if (tcplan && tcplan->s_tmpl == s_tmpl && tcplan->d_tmpl == d_tmpl) {
+        ++(table->hits);
+        return tcplan;
+    }
+
     /* check to see if plan is cached */
-    if (fbuf->latestTcplan) {
-        entry = fbuf->latestTcplan;
-        while (entry) {
-            tcplan = entry->tcplan;
-            if (tcplan->s_tmpl == s_tmpl &&
-                tcplan->d_tmpl == d_tmpl)
-            {
-                moveThisEntryToHeadOfDLL((fbDLL_t**)(void*)&(fbuf->latestTcplan),
-                                         NULL,
-                                         (fbDLL_t*)entry);
-                return tcplan;
-            }
-            entry = entry->next;
+    if (table->size) {
+        slot = fbTCPlanTableSlot(table, s_tmpl, d_tmpl);
+        if ((tcplan = table->slots[slot])) {
+            ++(table->hits);
+            table->memo = tcplan;
+            return tcplan;
         }
     }
+    ++(table->misses);
 
-    entry = g_slice_new0(fbTCPlanEntry_t);
+    /* keep the table at most three-quarters full */
+    if ((table->count + 1) * 4 > table->size * 3) {
+        fbTCPlanTableResize(table, table->size ? table->size * 2 :
+                            FB_TCPLAN_TABLE_MIN);
+    }
+    slot = fbTCPlanTableSlot(table, s_tmpl, d_tmpl);
 
     /* create new transcode plan and cache it */
-    entry->tcplan = g_slice_new0(fbTranscodePlan_t);
+    tcplan = g_slice_new0(fbTranscodePlan_t);
 
-    tcplan = entry->tcplan;
     /* fill in template refs */
     tcplan->s_tmpl = s_tmpl;
     tcplan->d_tmpl = d_tmpl;
 
-    tcplan->si = g_new0(int32_t, d_tmpl->ie_count);
-    /* for each destination element */
+    tcplan->si = g_new(int32_t, d_tmpl->ie_count);
     for (i = 0; i < d_tmpl->ie_count; i++) {
-        /* find source index */
-        if (g_hash_table_lookup_extended(s_tmpl->indices,
-                                         d_tmpl->ie_ary[i],
-                                         &sik, &siv)) {
-            tcplan->si[i] = GPOINTER_TO_INT(siv);
+        tcplan->si[i] = FB_TCPLAN_NULL;
+    }
+    /* find the source index of each destination element by walking the
+     * sorted indexes of both templates together */
+    for (i = 0, j = 0; i < d_tmpl->index_count && j < s_tmpl->index_count;) {
+        if (d_tmpl->indices[i].key < s_tmpl->indices[j].key) {
+            ++i;
+        } else if (s_tmpl->indices[j].key < d_tmpl->indices[i].key) {
+            ++j;
         } else {
-            tcplan->si[i] = FB_TCPLAN_NULL;
+            tcplan->si[d_tmpl->indices[i].pos] = s_tmpl->indices[j].pos;
+            ++i;
+            ++j;
         }
     }
 
-    attachHeadToDLL((fbDLL_t**)(void*)&(fbuf->latestTcplan),
-                    NULL,
-                    (fbDLL_t*)entry);
+    table->slots[slot] = tcplan;
+    ++(table->count);
+    table->memo = tcplan;
     return tcplan;
 }
 
 /**
- * fbTranscodeFreeVarlenOffsets
+ * fBufOffsetsPush
  *
- * @param s_tmpl
- * @param offsets
+ * Returns a scratch array of at least `count` entries for the field
+ * offsets of a variable-length record, and enters the next nesting level
+ * so that lists decoded within the record get their own array.  The
+ * arrays are kept and only grow, so steady-state transcoding of
+ * variable-length records does not allocate.  Each call must be matched
+ * by a call to fBufOffsetsPop().
+ *
+ * @param fbuf
+ * @param count
  *
  */
-static void         fbTranscodeFreeVarlenOffsets(
-    fbTemplate_t        *s_tmpl,
-    uint16_t            *offsets)
+static uint16_t    *fBufOffsetsPush(
+    fBuf_t              *fbuf,
+    uint32_t            count)
+{
+    fbOffsetScratch_t   *level;
+    uint32_t            levels;
+
+    /* add nesting levels if necessary */
+    if (fbuf->off_depth == fbuf->off_levels) {
+        levels = fbuf->off_levels ? fbuf->off_levels * 2 : 4;
+        fbuf->off_scratch = g_renew(fbOffsetScratch_t, fbuf->off_scratch,
+                                    levels);
+        memset(fbuf->off_scratch + fbuf->off_levels, 0,
+               (levels - fbuf->off_levels) * sizeof(fbOffsetScratch_t));
+        fbuf->off_levels = levels;
+    }
+
+    /* grow this level's array to fit the template if necessary */
+    level = &fbuf->off_scratch[fbuf->off_depth++];
+    if (level->count < count) {
+        g_free(level->offsets);
+        level->offsets = g_new(uint16_t, count);
+        level->count = count;
+    }
+
+    return level->offsets;
+}
+
+/**
+ * fBufOffsetsPop
+ *
+ * Leaves the nesting level entered by the matching fBufOffsetsPush().
+ *
+ * @param fbuf
+ *
+ */
+static void         fBufOffsetsPop(
+    fBuf_t              *fbuf)
+{
+    g_assert(fbuf->off_depth > 0);
+    --(fbuf->off_depth);
+}
+
+/**
+ * fBufOffsetsFree
+ *
+ * Frees the offset scratch arrays of `fbuf`.
+ *
+ * @param fbuf
+ *
+ */
+static void         fBufOffsetsFree(
+    fBuf_t              *fbuf)
 {
-    if (s_tmpl->is_varlen) g_free(offsets);
+    uint32_t            i;
+
+    for (i = 0; i < fbuf->off_levels; i++) {
+        g_free(fbuf->off_scratch[i].offsets);
+    }
+    g_free(fbuf->off_scratch);
+    g_free(fbuf->view_offsets);
 }
 
 /**
@@ -642,6 +861,8 @@ static void         fbTranscodeFreeVarlenOffsets(
  * @param s_base
  * @param s_rem
  * @param decode
+ * @param scratch - array of at least ie_count + 1 entries to hold the
+ *                  offsets if s_tmpl is variable-length
  * @param offsets_out
  * @param err - glib2 GError structure that returns the message on failure
  *
@@ -653,6 +874,7 @@ static ssize_t      fbTranscodeOffsets(
     uint8_t             *s_base,
     uint32_t            s_rem,
     gboolean            decode,
+    uint16_t            *scratch,
     uint16_t            **offsets_out,
     GError              **err)
 {
@@ -667,8 +889,13 @@ static ssize_t      fbTranscodeOffsets(
         return s_tmpl->off_cache[s_tmpl->ie_count];
     }
 
-    /* create new offsets array */
-    offsets = g_new0(uint16_t, s_tmpl->ie_count + 1);
+    /* use the scratch array for records whose offsets vary; create a new
+     * offsets array to cache for fixed-length templates */
+    if (s_tmpl->is_varlen) {
+        offsets = scratch;
+    } else {
+        offsets = g_new0(uint16_t, s_tmpl->ie_count + 1);
+    }
 
     /* populate it */
     for (i = 0, sp = s_base; i < s_tmpl->ie_count; i++) {
@@ -709,23 +936,20 @@ static ssize_t      fbTranscodeOffsets(
     s_len = offsets[i] = sp - s_base;
 
     /* cache offsets if possible */
-    if (!s_tmpl->is_varlen && offsets_out) {
+    if (!s_tmpl->is_varlen) {
         s_tmpl->off_cache = offsets;
     }
 
-    /* return offsets if possible */
-    if (offsets_out) {
-        *offsets_out = offsets;
-    } else {
-        *offsets_out = NULL;
-        fbTranscodeFreeVarlenOffsets(s_tmpl, offsets);
-    }
+    /* return offsets */
+    *offsets_out = offsets;
 
     /* return EOR offset */
     return s_len;
 
   err:
-    g_free(offsets);
+    if (!s_tmpl->is_varlen) {
+        g_free(offsets);
+    }
     return -1;
 }
 
@@ -757,6 +981,31 @@ static gboolean fbTranscodeZero(
 }
 
 
+/**
+ * fbTranscodeCopy
+ *
+ * Copies a run of fixed-length elements that need no conversion.
+ *
+ */
+static gboolean fbTranscodeCopy(
+    uint8_t             *sp,
+    uint8_t             **dp,
+    uint32_t            *d_rem,
+    uint32_t            len,
+    GError              **err)
+{
+    /* Check for write overrun */
+    FB_TC_DBC(len, "fixed copy");
+
+    memcpy(*dp, sp, len);
+
+    /* maintain counters */
+    *dp += len; *d_rem -= len;
+
+    return TRUE;
+}
+
+
 
 #if G_BYTE_ORDER == G_BIG_ENDIAN
 
@@ -830,6 +1079,213 @@ static void fbTranscodeSwap(
 }
 
 
+/*
+ * Byte swap kernels.  Each reverses the octets of `count` contiguous
+ * fields of a single width, copying from `sp` to `d`.  The SIMD variants
+ * are compiled for their target instruction set regardless of the flags
+ * used for the rest of the library, and are selected at run time by
+ * fbTranscodeSwapInit() when the processor supports them.
+ */
+typedef void (*fbSwapKernel_fn)(
+    const uint8_t       *sp,
+    uint8_t             *d,
+    uint32_t            count);
+
+static void fbSwap16Scalar(
+    const uint8_t       *sp,
+    uint8_t             *d,
+    uint32_t            count)
+{
+    uint16_t            v16;
+
+    for (; count; --count, sp += 2, d += 2) {
+        memcpy(&v16, sp, sizeof(v16));
+        v16 = GUINT16_SWAP_LE_BE(v16);
+        memcpy(d, &v16, sizeof(v16));
+    }
+}
+
+static void fbSwap32Scalar(
+    const uint8_t       *sp,
+    uint8_t             *d,
+    uint32_t            count)
+{
+    uint32_t            v32;
+
+    for (; count; --count, sp += 4, d += 4) {
+        memcpy(&v32, sp, sizeof(v32));
+        v32 = GUINT32_SWAP_LE_BE(v32);
+        memcpy(d, &v32, sizeof(v32));
+    }
+}
+
+static void fbSwap64Scalar(
+    const uint8_t       *sp,
+    uint8_t             *d,
+    uint32_t            count)
+{
+    uint64_t            v64;
+
+    for (; count; --count, sp += 8, d += 8) {
+        memcpy(&v64, sp, sizeof(v64));
+        v64 = GUINT64_SWAP_LE_BE(v64);
+        memcpy(d, &v64, sizeof(v64));
+    }
+}
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define FB_SWAP_SIMD 1
+#include <immintrin.h>
+
+/* pshufb masks reversing each 2, 4, and 8 octet field of a 16 octet lane */
+#define FB_SWAP_MASK16 \
+    1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14
+#define FB_SWAP_MASK32 \
+    3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12
+#define FB_SWAP_MASK64 \
+    7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8
+
+/*
+ * Defines an SSSE3 kernel for fields of `_w_` octets: swaps 16 octets per
+ * shuffle and finishes the run with the scalar kernel.
+ */
+#define FB_SWAP_SSSE3(_name_, _w_, _mask_, _tail_)                      \
+__attribute__((target("ssse3")))                                        \
+static void _name_(                                                     \
+    const uint8_t       *sp,                                            \
+    uint8_t             *d,                                             \
+    uint32_t            count)                                          \
+{                                                                       \
+    const __m128i       mask = _mm_setr_epi8(_mask_);                   \
+    __m128i             v;                                              \
+                                                                        \
+    for (; count >= 16 / (_w_); count -= 16 / (_w_), sp += 16, d += 16) \
+    {                                                                   \
+        v = _mm_loadu_si128((const __m128i *)sp);                       \
+        _mm_storeu_si128((__m128i *)d, _mm_shuffle_epi8(v, mask));      \
+    }                                                                   \
+    _tail_(sp, d, count);                                               \
+}
+
+/*
+ * Defines an AVX2 kernel for fields of `_w_` octets: swaps 32 octets per
+ * shuffle and finishes the run with the scalar kernel.  Fields never
+ * straddle the 16 octet lanes, so one mask serves both lanes.
+ */
+#define FB_SWAP_AVX2(_name_, _w_, _mask_, _tail_)                       \
+__attribute__((target("avx2")))                                         \
+static void _name_(                                                     \
+    const uint8_t       *sp,                                            \
+    uint8_t             *d,                                             \
+    uint32_t            count)                                          \
+{                                                                       \
+    const __m256i       mask = _mm256_setr_epi8(_mask_, _mask_);        \
+    __m256i             v;                                              \
+                                                                        \
+    for (; count >= 32 / (_w_); count -= 32 / (_w_), sp += 32, d += 32) \
+    {                                                                   \
+        v = _mm256_loadu_si256((const __m256i *)sp);                    \
+        _mm256_storeu_si256((__m256i *)d, _mm256_shuffle_epi8(v, mask)); \
+    }                                                                   \
+    _tail_(sp, d, count);                                               \
+}
+
+FB_SWAP_SSSE3(fbSwap16SSSE3, 2, FB_SWAP_MASK16, fbSwap16Scalar)
+FB_SWAP_SSSE3(fbSwap32SSSE3, 4, FB_SWAP_MASK32, fbSwap32Scalar)
+FB_SWAP_SSSE3(fbSwap64SSSE3, 8, FB_SWAP_MASK64, fbSwap64Scalar)
+FB_SWAP_AVX2(fbSwap16AVX2, 2, FB_SWAP_MASK16, fbSwap16Scalar)
+FB_SWAP_AVX2(fbSwap32AVX2, 4, FB_SWAP_MASK32, fbSwap32Scalar)
+FB_SWAP_AVX2(fbSwap64AVX2, 8, FB_SWAP_MASK64, fbSwap64Scalar)
+
+#endif  /* FB_SWAP_SIMD */
+
+/* Selected byte swap kernels for 2, 4, and 8 octet fields */
+static fbSwapKernel_fn fbSwap16 = fbSwap16Scalar;
+static fbSwapKernel_fn fbSwap32 = fbSwap32Scalar;
+static fbSwapKernel_fn fbSwap64 = fbSwap64Scalar;
+
+
+/**
+ * fbTranscodeSwapInit
+ *
+ * Selects the fastest byte swap kernels supported by the processor.
+ * Safe to call many times and from multiple threads; the selection is
+ * made once.
+ *
+ */
+static void fbTranscodeSwapInit(
+    void)
+{
+    static gsize        swap_init = 0;
+
+    if (!g_once_init_enter(&swap_init)) {
+        return;
+    }
+#if FB_SWAP_SIMD
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        fbSwap16 = fbSwap16AVX2;
+        fbSwap32 = fbSwap32AVX2;
+        fbSwap64 = fbSwap64AVX2;
+    } else if (__builtin_cpu_supports("ssse3")) {
+        fbSwap16 = fbSwap16SSSE3;
+        fbSwap32 = fbSwap32SSSE3;
+        fbSwap64 = fbSwap64SSSE3;
+    }
+#endif
+    g_once_init_leave(&swap_init, 1);
+}
+
+
+/**
+ * fbTranscodeSwapRun
+ *
+ * Copies `count` fields of `width` octets each from `sp` to `*dp`,
+ * reversing the octets of each field.  Used for runs of same-sized
+ * endian-sensitive elements in a compiled transcode plan; 2, 4, and 8
+ * octet runs use the kernels chosen by fbTranscodeSwapInit().
+ *
+ */
+static gboolean fbTranscodeSwapRun(
+    uint8_t             *sp,
+    uint8_t             **dp,
+    uint32_t            *d_rem,
+    uint32_t            width,
+    uint32_t            count,
+    GError              **err)
+{
+    uint8_t             *d = *dp;
+    uint32_t            len = width * count;
+    uint32_t            i, j;
+
+    FB_TC_DBC(len, "fixed swap");
+
+    switch (width) {
+      case 2:
+        fbSwap16(sp, d, count);
+        break;
+      case 4:
+        fbSwap32(sp, d, count);
+        break;
+      case 8:
+        fbSwap64(sp, d, count);
+        break;
+      default:
+        for (i = 0; i < count; ++i, sp += width, d += width) {
+            for (j = 0; j < width; ++j) {
+                d[j] = sp[(width-1)-j];
+            }
+        }
+        break;
+    }
+
+    /* maintain counters */
+    *dp += len; *d_rem -= len;
+
+    return TRUE;
+}
+
+
 /**
  * fbEncodeFixedLittleEndian
  *
@@ -1134,15 +1590,124 @@ static uint16_t fbSizeofIE(
     }
 }
 
-static gboolean validBasicList(
-    fbBasicList_t  *basicList,
-    GError        **err)
-{
-    if (!basicList) {
-        g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_IPFIX,
-                    "Null basic list pointer passed to encode");
-        return FALSE;
-    } else if (!basicList->infoElement) {
+/**
+ * fbTranscodePlanCompile
+ *
+ * Builds the instruction list for `tcplan` in the direction given by
+ * `decode`.  The plan's `si` array must already be filled in.
+ *
+ * @param tcplan
+ * @param decode
+ *
+ */
+static void fbTranscodePlanCompile(
+    fbTranscodePlan_t      *tcplan,
+    gboolean                decode)
+{
+    fbTemplate_t           *s_tmpl = tcplan->s_tmpl;
+    fbTemplate_t           *d_tmpl = tcplan->d_tmpl;
+    const fbInfoElement_t  *s_ie, *d_ie;
+    fbTranscodeOp_t        *op = NULL;
+    uint32_t                i, len;
+    int32_t                 si;
+    uint8_t                 code;
+
+#if G_BYTE_ORDER == G_LITTLE_ENDIAN
+    /* choose the byte swap kernels used by FB_TCOP_SWAP */
+    fbTranscodeSwapInit();
+#endif
+
+    /* there is never more than one instruction per destination IE */
+    g_free(tcplan->ops);
+    tcplan->ops = g_new0(fbTranscodeOp_t, d_tmpl->ie_count);
+    tcplan->op_count = 0;
+    tcplan->compiled = TRUE;
+    tcplan->decode = decode;
+
+    for (i = 0; i < d_tmpl->ie_count; i++) {
+        d_ie = d_tmpl->ie_ary[i];
+        si = tcplan->si[i];
+
+        if (si == FB_TCPLAN_NULL) {
+            /* Null source: zero the destination */
+            if (d_ie->len != FB_IE_VARLEN) {
+                len = d_ie->len;
+            } else if (decode) {
+                len = fbSizeofIE(d_ie);
+            } else {
+                len = 1;
+            }
+            if (op && op->code == FB_TCOP_ZERO) {
+                op->d_len += len;
+                ++op->count;
+                continue;
+            }
+            op = &tcplan->ops[tcplan->op_count++];
+            op->code = FB_TCOP_ZERO;
+            op->count = 1;
+            op->d_len = len;
+            continue;
+        }
+
+        s_ie = s_tmpl->ie_ary[si];
+        len = 0;
+        if (s_ie->len != FB_IE_VARLEN && d_ie->len != FB_IE_VARLEN) {
+            len = d_ie->len;
+            if (s_ie->len != d_ie->len) {
+                code = FB_TCOP_FIXED;
+#if G_BYTE_ORDER == G_LITTLE_ENDIAN
+            } else if (d_ie->len > 1 && (d_ie->flags & FB_IE_F_ENDIAN)) {
+                code = FB_TCOP_SWAP;
+#endif
+            } else {
+                code = FB_TCOP_COPY;
+            }
+            /* extend the previous run if the source is contiguous */
+            if (op && op->code == code && code != FB_TCOP_FIXED &&
+                (uint32_t)si == (uint32_t)op->si + op->count &&
+                (code == FB_TCOP_COPY || op->s_len == s_ie->len))
+            {
+                op->d_len += len;
+                ++op->count;
+                continue;
+            }
+        } else if (s_ie->len == FB_IE_VARLEN && d_ie->len == FB_IE_VARLEN) {
+            if (s_ie->type == FB_BASIC_LIST && d_ie->type == FB_BASIC_LIST) {
+                code = FB_TCOP_BASICLIST;
+            } else if (s_ie->type == FB_SUB_TMPL_LIST &&
+                       d_ie->type == FB_SUB_TMPL_LIST)
+            {
+                code = FB_TCOP_SUBTMPLLIST;
+            } else if (s_ie->type == FB_SUB_TMPL_MULTI_LIST &&
+                       d_ie->type == FB_SUB_TMPL_MULTI_LIST)
+            {
+                code = FB_TCOP_SUBTMPLMULTILIST;
+            } else {
+                code = FB_TCOP_VARFIELD;
+            }
+        } else {
+            code = FB_TCOP_MISMATCH;
+        }
+
+        op = &tcplan->ops[tcplan->op_count++];
+        op->code = code;
+        op->count = 1;
+        op->si = (uint16_t)si;
+        op->s_len = s_ie->len;
+        op->d_len = len;
+        op->flags = d_ie->flags;
+    }
+}
+
+static gboolean validBasicList(
+    fbBasicList_t  *basicList,
+    GError        **err)
+{
+    if (!basicList) {
+        g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_IPFIX,
+                    "Null basic list pointer passed to encode");
+        return FALSE;
+    } else if (!basicList->infoElement) {
         g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_IPFIX,
                     "Null information element in basic list passed to encode");
         return FALSE;
@@ -1259,6 +1824,69 @@ static void    bytesUsedBySrcTemplate(
     *bytesInSrc = srcWalker - data;
 }
 
+/**
+ * fBufListAlloc
+ *
+ * Allocates `len` zeroed bytes of storage for the content of a decoded
+ * list.  The storage comes from the list arena of `fbuf` when one is
+ * enabled by fBufSetListArena(), and from the slice allocator otherwise.
+ *
+ * @param fbuf
+ * @param len
+ *
+ */
+static void        *fBufListAlloc(
+    fBuf_t              *fbuf,
+    size_t              len)
+{
+    fbListArenaBlock_t  *block;
+    size_t              size;
+    uint8_t             *p;
+
+    if (!fbuf->arena_block_size) {
+        return g_slice_alloc0(len);
+    }
+
+    /* keep every allocation aligned for the list structures */
+    len = ((len + FB_LIST_ARENA_ALIGN - 1)
+           & ~(size_t)(FB_LIST_ARENA_ALIGN - 1));
+
+    block = fbuf->arena;
+    if (!block || block->size - block->used < len) {
+        size = MAX(fbuf->arena_block_size, len);
+        block = g_malloc(FB_LIST_ARENA_HDR + size);
+        block->size = size;
+        block->used = 0;
+        block->next = fbuf->arena;
+        fbuf->arena = block;
+    }
+
+    p = (uint8_t *)block + FB_LIST_ARENA_HDR + block->used;
+    block->used += len;
+    memset(p, 0, len);
+
+    return p;
+}
+
+/**
+ * fBufListArenaFree
+ *
+ * Frees every block of the list arena of `fbuf`.
+ *
+ * @param fbuf
+ *
+ */
+static void         fBufListArenaFree(
+    fBuf_t              *fbuf)
+{
+    fbListArenaBlock_t  *block;
+
+    while ((block = fbuf->arena)) {
+        fbuf->arena = block->next;
+        g_free(block);
+    }
+}
+
 static gboolean fbTranscode(
     fBuf_t             *fbuf,
     gboolean            decode,
@@ -1602,7 +2230,7 @@ static gboolean fbDecodeBasicList(
             if (!basicList->dataPtr) {
                 basicList->dataLength =
                     basicList->numElements * sizeof(fbBasicList_t);
-                basicList->dataPtr = g_slice_alloc0(basicList->dataLength);
+                basicList->dataPtr = fBufListAlloc(fbuf, basicList->dataLength);
             }
             thisItem = basicList->dataPtr;
             /* thisItem will be incremented by DecodeBasicList's dst
@@ -1622,7 +2250,7 @@ static gboolean fbDecodeBasicList(
             if (!basicList->dataPtr) {
                 basicList->dataLength =
                     basicList->numElements * sizeof(fbSubTemplateList_t);
-                basicList->dataPtr = g_slice_alloc0(basicList->dataLength);
+                basicList->dataPtr = fBufListAlloc(fbuf, basicList->dataLength);
             }
             thisItem = basicList->dataPtr;
             /* thisItem will be incremented by DecodeSubTemplateList's
@@ -1641,7 +2269,7 @@ static gboolean fbDecodeBasicList(
             if (!basicList->dataPtr) {
                 basicList->dataLength =
                     basicList->numElements * sizeof(fbSubTemplateMultiList_t);
-                basicList->dataPtr = g_slice_alloc0(basicList->dataLength);
+                basicList->dataPtr = fBufListAlloc(fbuf, basicList->dataLength);
             }
             thisItem = basicList->dataPtr;
             /* thisItem will be incremented by DecodeSubTemplateMultiList's
@@ -1661,7 +2289,7 @@ static gboolean fbDecodeBasicList(
             if (!basicList->dataPtr) {
                 basicList->dataLength =
                     basicList->numElements * sizeof(fbVarfield_t);
-                basicList->dataPtr = g_slice_alloc0(basicList->dataLength);
+                basicList->dataPtr = fBufListAlloc(fbuf, basicList->dataLength);
             }
 
             /* now pull the data numElements times */
@@ -1683,7 +2311,7 @@ static gboolean fbDecodeBasicList(
             basicList->numElements = srcLen / elementLen;
             if (!basicList->dataPtr) {
                 basicList->dataLength = srcLen;
-                basicList->dataPtr = g_slice_alloc0(basicList->dataLength);
+                basicList->dataPtr = fBufListAlloc(fbuf, basicList->dataLength);
             }
 
             thisItem = basicList->dataPtr;
@@ -1961,7 +2589,7 @@ static gboolean fbDecodeSubTemplateList(
                 subTemplateList->numElements;
             if (subTemplateList->dataLength.length) {
                 subTemplateList->dataPtr =
-                    g_slice_alloc0(subTemplateList->dataLength.length);
+                    fBufListAlloc(fbuf, subTemplateList->dataLength.length);
             }
             dstRem = subTemplateList->dataLength.length;
         } else {
@@ -1992,7 +2620,7 @@ static gboolean fbDecodeSubTemplateList(
         if (!subTemplateList->dataPtr) {
             if (subTemplateList->dataLength.length) {
                 subTemplateList->dataPtr =
-                    g_slice_alloc0(subTemplateList->dataLength.length);
+                    fBufListAlloc(fbuf, subTemplateList->dataLength.length);
             }
         }
         dstRem = subTemplateList->dataLength.length;
@@ -2247,7 +2875,7 @@ static gboolean fbDecodeSubTemplateMultiList(
         multiList->numElements++;
     }
 
-    multiList->firstEntry = g_slice_alloc0(multiList->numElements *
+    multiList->firstEntry = fBufListAlloc(fbuf, multiList->numElements *
                                       sizeof(fbSubTemplateMultiListEntry_t));
     entry = multiList->firstEntry;
 
@@ -2353,12 +2981,12 @@ static gboolean fbDecodeSubTemplateMultiList(
 
             entry->dataLength = intTemplate->ie_internal_len *
                                 entry->numElements;
-            entry->dataPtr = g_slice_alloc0(entry->dataLength);
+            entry->dataPtr = fBufListAlloc(fbuf, entry->dataLength);
         } else {
             entry->numElements = thisTemplateLength / extTemplate->ie_len;
             entry->dataLength = entry->numElements *
                                 intTemplate->ie_internal_len;
-            entry->dataPtr = g_slice_alloc0(entry->dataLength);
+            entry->dataPtr = fBufListAlloc(fbuf, entry->dataLength);
         }
 
         dstRem = entry->dataLength;
@@ -2415,15 +3043,16 @@ static gboolean fbDecodeSubTemplateMultiList(
 
 
 /**
- * fbTranscode
- *
- *
- *
+ * fbTranscodeWithPlan
  *
+ * Transcodes a single record using a plan previously returned by
+ * fbTranscodePlan().  Allows callers that transcode many records with
+ * the same pair of templates to avoid the plan lookup.
  *
  */
-static gboolean fbTranscode(
+static gboolean fbTranscodeWithPlan(
     fBuf_t              *fbuf,
+    fbTranscodePlan_t   *tcplan,
     gboolean            decode,
     uint8_t             *s_base,
     uint8_t             *d_base,
@@ -2431,35 +3060,32 @@ static gboolean fbTranscode(
     size_t              *d_len,
     GError              **err)
 {
-    fbTranscodePlan_t   *tcplan;
-    fbTemplate_t        *s_tmpl, *d_tmpl;
+    const fbTranscodeOp_t *op, *op_end;
+    fbTemplate_t        *s_tmpl = tcplan->s_tmpl;
     ssize_t             s_len_offset;
     uint16_t            *offsets;
+    uint16_t            *scratch = NULL;
     uint8_t             *dp;
-    uint32_t            s_off, d_rem, i;
-    fbInfoElement_t     *s_ie, *d_ie;
+    uint32_t            d_rem;
     gboolean            ok = TRUE;
-    uint8_t             ie_type;
 
     /* initialize walk of dest buffer */
     dp = d_base; d_rem = *d_len;
-    /* select templates for transcode */
-    if (decode) {
-        s_tmpl = fbuf->ext_tmpl;
-        d_tmpl = fbuf->int_tmpl;
-    } else {
-        s_tmpl = fbuf->int_tmpl;
-        d_tmpl = fbuf->ext_tmpl;
-    }
 
-    /* get a transcode plan */
-    tcplan = fbTranscodePlan(fbuf, s_tmpl, d_tmpl);
+    /* compile the plan for this direction if necessary */
+    if (!tcplan->compiled || tcplan->decode != decode) {
+        fbTranscodePlanCompile(tcplan, decode);
+    }
 
     /* get source record length and offsets */
-    if ((s_len_offset = fbTranscodeOffsets(s_tmpl, s_base, *s_len,
-                                           decode, &offsets, err)) < 0)
+    if (s_tmpl->is_varlen) {
+        scratch = fBufOffsetsPush(fbuf, s_tmpl->ie_count + 1);
+    }
+    if ((s_len_offset = fbTranscodeOffsets(s_tmpl, s_base, *s_len, decode,
+                                           scratch, &offsets, err)) < 0)
     {
-        return FALSE;
+        ok = FALSE;
+        goto end;
     }
     *s_len = s_len_offset;
 #if FB_DEBUG_TC && FB_DEBUG_RD && FB_DEBUG_WR
@@ -2479,149 +3105,79 @@ static gboolean fbTranscode(
     }
 #endif
 
-    /* iterate over destination IEs, copying from source */
-    for (i = 0; i < d_tmpl->ie_count; i++) {
-        /* Get pointers to information elements and source offset */
-        d_ie = d_tmpl->ie_ary[i];
-        s_ie = (tcplan->si[i] == FB_TCPLAN_NULL) ? NULL : s_tmpl->ie_ary[tcplan->si[i]];
-        s_off = s_ie ? offsets[tcplan->si[i]] : 0;
-        if (s_ie == NULL) {
-            /* Null source */
-            uint32_t null_len;
-            if (d_ie->len == FB_IE_VARLEN) {
-                if (decode) {
-                    ie_type = d_ie->type;
-                    if (ie_type == FB_BASIC_LIST) {
-                        null_len = sizeof(fbBasicList_t);
-                    } else if (ie_type == FB_SUB_TMPL_LIST) {
-                        null_len = sizeof(fbSubTemplateList_t);
-                    } else if (ie_type == FB_SUB_TMPL_MULTI_LIST) {
-                        null_len = sizeof(fbSubTemplateMultiList_t);
-                    } else {
-                        null_len = sizeof(fbVarfield_t);
-                    }
-                } else {
-                    null_len = 1;
-                }
+    /* run the compiled plan, copying from source */
+    for (op = tcplan->ops, op_end = op + tcplan->op_count; op < op_end; ++op)
+    {
+        switch (op->code) {
+          case FB_TCOP_COPY:
+            ok = fbTranscodeCopy(s_base + offsets[op->si], &dp, &d_rem,
+                                 op->d_len, err);
+            break;
+#if G_BYTE_ORDER == G_LITTLE_ENDIAN
+          case FB_TCOP_SWAP:
+            ok = fbTranscodeSwapRun(s_base + offsets[op->si], &dp, &d_rem,
+                                    op->s_len, op->count, err);
+            break;
+#endif
+          case FB_TCOP_ZERO:
+            ok = fbTranscodeZero(&dp, &d_rem, op->d_len, err);
+            break;
+          case FB_TCOP_FIXED:
+            if (decode) {
+                ok = fbDecodeFixed(s_base + offsets[op->si], &dp, &d_rem,
+                                   op->s_len, op->d_len, op->flags, err);
             } else {
-                null_len = d_ie->len;
+                ok = fbEncodeFixed(s_base + offsets[op->si], &dp, &d_rem,
+                                   op->s_len, op->d_len, op->flags, err);
             }
-            if (!(ok = fbTranscodeZero(&dp, &d_rem, null_len, err))) {
-                goto end;
-            }
-        } else if (s_ie->len != FB_IE_VARLEN && d_ie->len != FB_IE_VARLEN) {
+            break;
+          case FB_TCOP_VARFIELD:
             if (decode) {
-                ok = fbDecodeFixed(s_base + s_off, &dp, &d_rem,
-                                   s_ie->len, d_ie->len,
-                                   d_ie->flags, err);
+                ok = fbDecodeVarfield(s_base + offsets[op->si], &dp, &d_rem,
+                                      op->flags, err);
             } else {
-                ok = fbEncodeFixed(s_base + s_off, &dp, &d_rem,
-                                   s_ie->len, d_ie->len,
-                                   d_ie->flags, err);
-            }
-            if (!ok) {
-                goto end;
-            }
-        } else if (s_ie->len == FB_IE_VARLEN && d_ie->len == FB_IE_VARLEN) {
-            /* Varlen transcode */
-            if (s_ie->type == FB_BASIC_LIST &&
-                d_ie->type == FB_BASIC_LIST)
-            {
-                if (decode) {
-                    ok = fbDecodeBasicList(fbuf->ext_tmpl->model,
-                                           s_base + s_off,
-                                           &dp, &d_rem, fbuf,
-                                           err);
-                } else {
-                    ok = fbEncodeBasicList(s_base + s_off, &dp, &d_rem,
-                                           fbuf, err);
-                }
-                if (!ok) {
-                    goto end;
-                }
+                ok = fbEncodeVarfield(s_base + offsets[op->si], &dp, &d_rem,
+                                      op->flags, err);
             }
-            else if (s_ie->type == FB_SUB_TMPL_LIST &&
-                     d_ie->type == FB_SUB_TMPL_LIST)
-            {
-                if (decode) {
-                    ok = fbDecodeSubTemplateList(s_base + s_off,
-                                                 &dp,
-                                                 &d_rem,
-                                                 fbuf,
-                                                 err);
-                } else {
-                    ok = fbEncodeSubTemplateList(s_base + s_off,
-                                                 &dp,
-                                                 &d_rem,
-                                                 fbuf,
-                                                 err);
-                }
-                if (!ok) {
-                    goto end;
-                }
+            break;
+          case FB_TCOP_BASICLIST:
+            if (decode) {
+                ok = fbDecodeBasicList(fbuf->ext_tmpl->model,
+                                       s_base + offsets[op->si],
+                                       &dp, &d_rem, fbuf, err);
+            } else {
+                ok = fbEncodeBasicList(s_base + offsets[op->si],
+                                       &dp, &d_rem, fbuf, err);
             }
-            else if (s_ie->type == FB_SUB_TMPL_MULTI_LIST &&
-                     d_ie->type == FB_SUB_TMPL_MULTI_LIST)
-            {
-                if (decode) {
-                    ok = fbDecodeSubTemplateMultiList(s_base + s_off,
-                                                      &dp,
-                                                      &d_rem,
-                                                      fbuf,
-                                                      err);
-                } else {
-                    ok = fbEncodeSubTemplateMultiList(s_base + s_off,
-                                                      &dp,
-                                                      &d_rem,
-                                                      fbuf,
-                                                      err);
-                }
-
-                if (!ok) {
-                    goto end;
-                }
+            break;
+          case FB_TCOP_SUBTMPLLIST:
+            if (decode) {
+                ok = fbDecodeSubTemplateList(s_base + offsets[op->si],
+                                             &dp, &d_rem, fbuf, err);
             } else {
-                if (decode) {
-                    ok = fbDecodeVarfield(s_base + s_off, &dp, &d_rem,
-                                          d_ie->flags, err);
-                } else {
-                    ok = fbEncodeVarfield(s_base + s_off, &dp, &d_rem,
-                                          d_ie->flags, err);
-                }
+                ok = fbEncodeSubTemplateList(s_base + offsets[op->si],
+                                             &dp, &d_rem, fbuf, err);
             }
-            if (!ok) {
-                goto end;
+            break;
+          case FB_TCOP_SUBTMPLMULTILIST:
+            if (decode) {
+                ok = fbDecodeSubTemplateMultiList(s_base + offsets[op->si],
+                                                  &dp, &d_rem, fbuf, err);
+            } else {
+                ok = fbEncodeSubTemplateMultiList(s_base + offsets[op->si],
+                                                  &dp, &d_rem, fbuf, err);
             }
-        } else {
+            break;
+          default:
             /* Fixed to varlen or vice versa */
             g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_IMPL,
                         "Transcoding between fixed and varlen IE "
                         "not supported by this version of libfixbuf.");
             ok = FALSE;
+            break;
+        }
+        if (!ok) {
             goto end;
-
-/*            if (s_ie->len == FB_IE_VARLEN && d_ie->len != FB_IE_VARLEN) {
-                if (decode) {
-                    printf("decode varlen to fixed\n");
-                    ok = fbDecodeVarlenToFixed(s_base + s_off, &dp, &d_rem,
-                                          d_ie->flags, err);
-                } else {
-                    ok = fbEncodeVarlenToFixed(s_base + s_off, d_ie->len, &dp,
-                                               &d_rem, d_ie->flags, err);
-                }
-            } else {
-                if (decode) {
-                    printf("decode fixed to varlen\n");
-                    ok = fbDecodeFixedToVarlen(s_base + s_off, &dp, &d_rem,
-                                          d_ie->flags, err);
-                } else {
-                    ok = fbEncodeFixedToVarlen(s_base + s_off, s_ie->len, &dp,
-                                               &d_rem, d_ie->flags, err);
-                }
-            }
-            if (!ok) {
-                goto end;
-            }*/
         }
     }
 
@@ -2637,10 +3193,43 @@ static gboolean fbTranscode(
 #endif
     /* All done */
   end:
-    fbTranscodeFreeVarlenOffsets(s_tmpl, offsets);
+    if (scratch) {
+        fBufOffsetsPop(fbuf);
+    }
     return ok;
 }
 
+
+/**
+ * fbTranscode
+ *
+ *
+ *
+ *
+ *
+ */
+static gboolean fbTranscode(
+    fBuf_t              *fbuf,
+    gboolean            decode,
+    uint8_t             *s_base,
+    uint8_t             *d_base,
+    size_t              *s_len,
+    size_t              *d_len,
+    GError              **err)
+{
+    fbTranscodePlan_t   *tcplan;
+
+    /* select templates for transcode and get a transcode plan */
+    if (decode) {
+        tcplan = fbTranscodePlan(fbuf, fbuf->ext_tmpl, fbuf->int_tmpl);
+    } else {
+        tcplan = fbTranscodePlan(fbuf, fbuf->int_tmpl, fbuf->ext_tmpl);
+    }
+
+    return fbTranscodeWithPlan(fbuf, tcplan, decode, s_base, d_base,
+                               s_len, d_len, err);
+}
+
 /*==================================================================
  *
  * Common Buffer Management Functions
@@ -2648,6 +3237,85 @@ static gboolean fbTranscode(
  *==================================================================*/
 
 
+/**
+ * fBufReleaseMessageBuffer
+ *
+ * Returns the buffer's message buffer, if any, to the message buffer
+ * pool, freeing it if the pool for its size class is full.
+ *
+ */
+static void     fBufReleaseMessageBuffer(
+    fBuf_t          *fbuf)
+{
+    fbMsgBufFree_t  *mb = (fbMsgBufFree_t *)fbuf->buf;
+    unsigned int    cls = fbuf->buf_class;
+
+    if (!mb) {
+        return;
+    }
+    fbuf->buf = NULL;
+
+    pthread_mutex_lock(&fbMsgBufPoolLock);
+    if (fbMsgBufPoolCount[cls] < FB_MSGBUF_POOL_DEPTH) {
+        mb->next = fbMsgBufPoolFree[cls];
+        fbMsgBufPoolFree[cls] = mb;
+        ++fbMsgBufPoolCount[cls];
+        mb = NULL;
+    }
+    pthread_mutex_unlock(&fbMsgBufPoolLock);
+
+    if (mb) {
+        g_slice_free1((size_t)1 << (FB_MSGBUF_MIN_SHIFT + cls), mb);
+    }
+}
+
+
+/**
+ * fBufAcquireMessageBuffer
+ *
+ * Ensures the buffer has a message buffer of at least `size` octets.
+ * Keeps the current message buffer if it is large enough; otherwise
+ * returns it to the pool and borrows one from the message buffer pool,
+ * allocating one if the pool has none of that size class.
+ *
+ */
+static void     fBufAcquireMessageBuffer(
+    fBuf_t          *fbuf,
+    size_t          size)
+{
+    fbMsgBufFree_t  *mb;
+    unsigned int    cls = 0;
+
+    while (((size_t)1 << (FB_MSGBUF_MIN_SHIFT + cls)) < size) {
+        ++cls;
+    }
+    g_assert(cls < FB_MSGBUF_CLASSES);
+
+    if (fbuf->buf) {
+        if (fbuf->buf_class >= cls) {
+            return;
+        }
+        fBufReleaseMessageBuffer(fbuf);
+    }
+
+    pthread_mutex_lock(&fbMsgBufPoolLock);
+    mb = fbMsgBufPoolFree[cls];
+    if (mb) {
+        fbMsgBufPoolFree[cls] = mb->next;
+        --fbMsgBufPoolCount[cls];
+    }
+    pthread_mutex_unlock(&fbMsgBufPoolLock);
+
+    if (mb) {
+        fbuf->buf = (uint8_t *)mb;
+    } else {
+        fbuf->buf = (uint8_t *)g_slice_alloc(
+            (size_t)1 << (FB_MSGBUF_MIN_SHIFT + cls));
+    }
+    fbuf->buf_class = cls;
+}
+
+
 /**
  * fBufRewind
  *
@@ -2660,8 +3328,11 @@ void            fBufRewind(
     fBuf_t          *fbuf)
 {
     if (fbuf->collector || fbuf->exporter) {
-        /* Reset the buffer */
-        fbuf->cp = fbuf->buf;
+        /* The exporter has copied the message, and records read from it
+         * are only valid until the next read; return the message buffer
+         * to the pool until the next message */
+        fBufReleaseMessageBuffer(fbuf);
+        fbuf->cp = NULL;
     } else {
         /* set the buffer to the end of the message */
         fbuf->cp = fbuf->mep;
@@ -2803,22 +3474,11 @@ fbSession_t     *fBufGetSession(
 void            fBufFree(
     fBuf_t          *fbuf)
 {
-    fbTCPlanEntry_t *entry;
-
     if (NULL == fbuf) {
         return;
     }
     /* free the tcplans */
-    while (fbuf->latestTcplan) {
-        entry = fbuf->latestTcplan;
-
-        detachHeadOfDLL((fbDLL_t**)(void*)&(fbuf->latestTcplan), NULL,
-                        (fbDLL_t**)(void*)&entry);
-        g_free(entry->tcplan->si);
-
-        g_slice_free1(sizeof(fbTranscodePlan_t), entry->tcplan);
-        g_slice_free1(sizeof(fbTCPlanEntry_t), entry);
-    }
+    fbTCPlanTableClear(&fbuf->tcplans, NULL);
     if (fbuf->exporter) {
         fbExporterFree(fbuf->exporter);
     }
@@ -2827,6 +3487,9 @@ void            fBufFree(
         fbCollectorFree(fbuf->collector);
     }
 
+    fBufReleaseMessageBuffer(fbuf);
+    fBufOffsetsFree(fbuf);
+    fBufListArenaFree(fbuf);
     fbSessionFree(fbuf->session);
     g_slice_free(fBuf_t, fbuf);
 }
@@ -2853,14 +3516,19 @@ void            fBufFree(
 static void     fBufAppendMessageHeader(
     fBuf_t          *fbuf)
 {
+    uint16_t        mtu;
+
     /* can only append message header at start of buffer */
-    g_assert(fbuf->cp == fbuf->buf);
+    g_assert(!fbuf->msgbase);
 
     /* can only append message header if we have an exporter */
     g_assert(fbuf->exporter);
 
-    /* get MTU from exporter */
-    fbuf->mep += fbExporterGetMTU(fbuf->exporter);
+    /* get MTU from exporter and borrow a buffer to hold the message */
+    mtu = fbExporterGetMTU(fbuf->exporter);
+    fBufAcquireMessageBuffer(fbuf, mtu);
+    fbuf->cp = fbuf->buf;
+    fbuf->mep = fbuf->cp + mtu;
     g_assert(FB_REM_MSG(fbuf) > FB_MTU_MIN);
 
     /* set message base pointer to show we have an active message */
@@ -2900,9 +3568,8 @@ static void     fBufAppendMessageHeader(
  *
  *
  */
-static gboolean fBufAppendSetHeader(
-    fBuf_t          *fbuf,
-    GError          **err)
+static fBufStatus_t fBufAppendSetHeader(
+    fBuf_t          *fbuf)
 {
     uint16_t        set_id, set_minlen;
 
@@ -2917,12 +3584,7 @@ static gboolean fBufAppendSetHeader(
 
     /* Need enough space in the message for a set header and a record */
     if (FB_REM_MSG(fbuf) < set_minlen) {
-        g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_EOM,
-                    "End of message. "
-                    "Overrun on set header append "
-                    "(need %u bytes, %u available)",
-                    set_minlen, (uint32_t)FB_REM_MSG(fbuf));
-        return FALSE;
+        return FB_STATUS_EOM;
     }
 
     /* set set base pointer to show we have an active set */
@@ -2937,7 +3599,7 @@ static gboolean fBufAppendSetHeader(
     fBufDebugBuffer("aset", fbuf, 4, TRUE);
 #endif
 
-    return TRUE;
+    return FB_STATUS_OK;
 }
 
 
@@ -3143,41 +3805,27 @@ void fBufRemoveTemplateTcplan(
     fBuf_t         *fbuf,
     fbTemplate_t   *tmpl)
 {
-    fbTCPlanEntry_t    *entry;
-    fbTCPlanEntry_t    *otherEntry;
     if (!fbuf || !tmpl) {
         return;
     }
 
-    entry = fbuf->latestTcplan;
-
-    while (entry) {
-        if (entry->tcplan->s_tmpl == tmpl ||
-            entry->tcplan->d_tmpl == tmpl)
-        {
-            if (entry == fbuf->latestTcplan) {
-                otherEntry = NULL;
-            } else {
-                otherEntry = entry->next;
-            }
-
-            detachThisEntryOfDLL((fbDLL_t**)(void*)(&(fbuf->latestTcplan)),
-                                 NULL,
-                                 (fbDLL_t*)entry);
-
-            g_free(entry->tcplan->si);
-
-            g_slice_free1(sizeof(fbTranscodePlan_t), entry->tcplan);
-            g_slice_free1(sizeof(fbTCPlanEntry_t), entry);
+    fbTCPlanTableClear(&fbuf->tcplans, tmpl);
+}
 
-            if (otherEntry) {
-                entry = otherEntry;
-            } else {
-                entry = fbuf->latestTcplan;
-            }
-        } else {
-            entry = entry->next;
-        }
+/**
+ * fBufGetTranscodePlanStats
+ *
+ */
+void fBufGetTranscodePlanStats(
+    fBuf_t         *fbuf,
+    uint64_t       *hits,
+    uint64_t       *misses)
+{
+    if (hits) {
+        *hits = fbuf->tcplans.hits;
+    }
+    if (misses) {
+        *misses = fbuf->tcplans.misses;
     }
 }
 
@@ -3189,23 +3837,20 @@ void fBufRemoveTemplateTcplan(
  *
  *
  */
-static gboolean fBufAppendTemplateSingle(
+static fBufStatus_t fBufAppendTemplateSingle(
     fBuf_t          *fbuf,
     uint16_t        tmpl_id,
     fbTemplate_t    *tmpl,
-    gboolean        revoked,
-    GError          **err)
+    gboolean        revoked)
 {
     uint16_t        spec_tid, tmpl_len, ie_count, scope_count;
+    fBufStatus_t    status;
     int             i;
 
     /* Force message closed to start a new template message */
     if (!fbuf->spec_tid) {
         fbuf->spec_tid = (tmpl->scope_count) ? FB_TID_OTS : FB_TID_TS;
-        g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_EOM,
-                    "End of message. "
-                    "Must start new message for template export.");
-        return FALSE;
+        return FB_STATUS_EOM;
     }
 
     /* Start a new message if necessary */
@@ -3222,7 +3867,9 @@ static gboolean fBufAppendTemplateSingle(
 
     /* Start a new set if necessary */
     if (!fbuf->setbase) {
-        if (!fBufAppendSetHeader(fbuf, err)) return FALSE;
+        if ((status = fBufAppendSetHeader(fbuf)) != FB_STATUS_OK) {
+            return status;
+        }
     }
 
     /*
@@ -3241,12 +3888,7 @@ static gboolean fBufAppendTemplateSingle(
 
     /* Ensure we have enough space for the template in the message */
     if (FB_REM_MSG(fbuf) < tmpl_len) {
-        g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_EOM,
-                    "End of message. "
-                    "Overrun on template append "
-                    "(need %u bytes, %u available)",
-                    tmpl_len, (uint32_t)FB_REM_MSG(fbuf));
-        return FALSE;
+        return FB_STATUS_EOM;
     }
 
     /* Copy the template header to the message */
@@ -3284,45 +3926,104 @@ static gboolean fBufAppendTemplateSingle(
 #endif
 
     /* Done */
-    return TRUE;
+    return FB_STATUS_OK;
 }
 
 
 /**
- * fBufAppendTemplate
- *
- *
- *
+ * fBufAppendRetryable
  *
+ * Handles a failed append.  If the failure was an end of message and the
+ * buffer is in automatic mode, emits the message and returns TRUE so the
+ * caller may retry the append in a new message.  Otherwise returns FALSE
+ * with `err` set.
  *
  */
-gboolean        fBufAppendTemplate(
+static gboolean fBufAppendRetryable(
     fBuf_t          *fbuf,
-    uint16_t        tmpl_id,
-    fbTemplate_t    *tmpl,
-    gboolean        revoked,
+    fBufStatus_t    status,
     GError          **err)
 {
-    g_assert(err);
-
-    /* printf("fBufAppendTemplate: %x\n", tmpl_id); */
-    /* Attempt single append */
-    if (fBufAppendTemplateSingle(fbuf, tmpl_id, tmpl, revoked, err)) {
-        return TRUE;
+    /* Fail if not EOM */
+    if (FB_STATUS_EOM != status &&
+        !g_error_matches(*err, FB_ERROR_DOMAIN, FB_ERROR_EOM))
+    {
+        return FALSE;
     }
 
-    /* Fail if not EOM or not automatic */
-    if (!g_error_matches(*err, FB_ERROR_DOMAIN, FB_ERROR_EOM) ||
-        !fbuf->automatic) return FALSE;
+    /* Fail if not automatic */
+    if (!fbuf->automatic) {
+        if (FB_STATUS_EOM == status) {
+            g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_EOM,
+                        "End of message. "
+                        "Overrun on append (%u bytes available)",
+                        (uint32_t)FB_REM_MSG(fbuf));
+        }
+        return FALSE;
+    }
 
     /* Retryable. Clear error. */
     g_clear_error(err);
 
     /* Emit message */
-    if (!fBufEmit(fbuf, err)) return FALSE;
+    return fBufEmit(fbuf, err);
+}
+
+
+/**
+ * fBufAppendFinish
+ *
+ * Converts the status of a retried append into a gboolean return,
+ * setting `err` if the record still does not fit.
+ *
+ */
+static gboolean fBufAppendFinish(
+    fBuf_t          *fbuf,
+    fBufStatus_t    status,
+    GError          **err)
+{
+    if (FB_STATUS_EOM == status) {
+        g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_EOM,
+                    "End of message. "
+                    "Overrun on append (%u bytes available)",
+                    (uint32_t)FB_REM_MSG(fbuf));
+    }
+    return (FB_STATUS_OK == status);
+}
+
+
+/**
+ * fBufAppendTemplate
+ *
+ *
+ *
+ *
+ *
+ */
+gboolean        fBufAppendTemplate(
+    fBuf_t          *fbuf,
+    uint16_t        tmpl_id,
+    fbTemplate_t    *tmpl,
+    gboolean        revoked,
+    GError          **err)
+{
+    fBufStatus_t    status;
+
+    g_assert(err);
+
+    /* printf("fBufAppendTemplate: %x\n", tmpl_id); */
+    /* Attempt single append */
+    status = fBufAppendTemplateSingle(fbuf, tmpl_id, tmpl, revoked);
+    if (FB_STATUS_OK == status) {
+        return TRUE;
+    }
+
+    /* Emit the message if EOM in automatic mode; fail otherwise */
+    if (!fBufAppendRetryable(fbuf, status, err)) return FALSE;
 
     /* Retry single append */
-    return fBufAppendTemplateSingle(fbuf, tmpl_id, tmpl, revoked, err);
+    status = fBufAppendTemplateSingle(fbuf, tmpl_id, tmpl, revoked);
+    return fBufAppendFinish(fbuf, status, err);
 }
 
 
@@ -3334,13 +4035,14 @@ gboolean        fBufAppendTemplate(
  *
  *
  */
-static gboolean fBufAppendSingle(
+static fBufStatus_t fBufAppendSingle(
     fBuf_t          *fbuf,
     uint8_t         *recbase,
     size_t          recsize,
     GError          **err)
 {
     size_t          bufsize;
+    fBufStatus_t    status;
 
     /* Buffer must have active templates */
     g_assert(fbuf->int_tmpl);
@@ -3349,10 +4051,7 @@ static gboolean fBufAppendSingle(
     /* Force message closed to finish any active template message */
     if (fbuf->spec_tid) {
         fbuf->spec_tid = 0;
-        g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_EOM,
-                    "End of message. "
-                    "Must start new message after template export.");
-        return FALSE;
+        return FB_STATUS_EOM;
     }
 
     /* Start a new message if necessary */
@@ -3368,15 +4067,22 @@ static gboolean fBufAppendSingle(
 
     /* Start a new set if necessary */
     if (!fbuf->setbase) {
-        if (!fBufAppendSetHeader(fbuf, err))
-            return FALSE;
+        if ((status = fBufAppendSetHeader(fbuf)) != FB_STATUS_OK)
+            return status;
+    }
+
+    /* A fixed-length record that does not fit ends the message */
+    if (!fbuf->ext_tmpl->is_varlen &&
+        FB_REM_MSG(fbuf) < fbuf->ext_tmpl->ie_len)
+    {
+        return FB_STATUS_EOM;
     }
 
     /* Transcode bytes into buffer */
     bufsize = FB_REM_MSG(fbuf);
 
     if (!fbTranscode(fbuf, FALSE, recbase, fbuf->cp, &recsize, &bufsize, err))
-        return FALSE;
+        return FB_STATUS_ERROR;
 
     /* Move current pointer forward by number of bytes written */
     fbuf->cp += bufsize;
@@ -3388,7 +4094,7 @@ static gboolean fBufAppendSingle(
 #endif
 
     /* Done */
-    return TRUE;
+    return FB_STATUS_OK;
 }
 
 
@@ -3406,24 +4112,95 @@ gboolean        fBufAppend(
     size_t          recsize,
     GError          **err)
 {
+    fBufStatus_t    status;
+
     g_assert(recbase);
     g_assert(err);
 
     /* Attempt single append */
-    if (fBufAppendSingle(fbuf, recbase, recsize, err)) return TRUE;
+    status = fBufAppendSingle(fbuf, recbase, recsize, err);
+    if (FB_STATUS_OK == status) return TRUE;
 
-    /* Fail if not EOM or not automatic */
-    if (!g_error_matches(*err, FB_ERROR_DOMAIN, FB_ERROR_EOM) ||
-        !fbuf->automatic) return FALSE;
+    /* Emit the message if EOM in automatic mode; fail otherwise */
+    if (!fBufAppendRetryable(fbuf, status, err)) return FALSE;
 
-    /* Retryable. Clear error. */
-    g_clear_error(err);
+    /* Retry single append */
+    status = fBufAppendSingle(fbuf, recbase, recsize, err);
+    return fBufAppendFinish(fbuf, status, err);
+}
 
-    /* Emit message */
-    if (!fBufEmit(fbuf, err)) return FALSE;
 
-    /* Retry single append */
-    return fBufAppendSingle(fbuf, recbase, recsize, err);
+/**
+ * fBufAppendBatch
+ *
+ *
+ *
+ *
+ *
+ */
+gboolean        fBufAppendBatch(
+    fBuf_t          *fbuf,
+    uint8_t         *recbase,
+    size_t          stride,
+    size_t          count,
+    size_t          *appended,
+    GError          **err)
+{
+    fbTranscodePlan_t   *tcplan;
+    fBufStatus_t        status;
+    size_t              bufsize;
+    size_t              recsize;
+    size_t              i = 0;
+
+    g_assert(recbase);
+    g_assert(err);
+
+    while (i < count) {
+        /* Append one record the normal way; this starts the message and
+         * set as required and emits the message when it is full. */
+        if (!fBufAppend(fbuf, recbase + (i * stride), stride, err)) {
+            goto end;
+        }
+        ++i;
+
+        /* Append as many of the rest as fit into the current set */
+        tcplan = fbTranscodePlan(fbuf, fbuf->int_tmpl, fbuf->ext_tmpl);
+        for ( ; i < count; ++i) {
+            bufsize = FB_REM_MSG(fbuf);
+            recsize = stride;
+            if (!tcplan->d_tmpl->is_varlen &&
+                bufsize < tcplan->d_tmpl->ie_len)
+            {
+                status = FB_STATUS_EOM;
+            } else if (!fbTranscodeWithPlan(fbuf, tcplan, FALSE,
+                                            recbase + (i * stride), fbuf->cp,
+                                            &recsize, &bufsize, err))
+            {
+                status = FB_STATUS_ERROR;
+            } else {
+                status = FB_STATUS_OK;
+            }
+            if (FB_STATUS_OK != status) {
+                /* Message is full.  Emit it in automatic mode;
+                 * fBufAppend() will start the next one. */
+                if (!fBufAppendRetryable(fbuf, status, err)) {
+                    goto end;
+                }
+                break;
+            }
+            fbuf->cp += bufsize;
+            ++(fbuf->rc);
+#if FB_DEBUG_WR
+            fBufDebugBuffer("arec", fbuf, bufsize, TRUE);
+#endif
+        }
+    }
+
+  end:
+    if (appended) {
+        *appended = i;
+    }
+    return (i == count);
 }
 
 
@@ -3612,6 +4389,7 @@ gboolean fBufNextMessage(
     GError          **err)
 {
     size_t          msglen;
+    uint8_t         *mapped;
     uint16_t        mh_version, mh_len;
     uint32_t        ex_sequence, mh_sequence, mh_domain;
 
@@ -3626,10 +4404,27 @@ gboolean fBufNextMessage(
 
     /* Read next message from the collector */
     if (fbuf->collector) {
-        msglen = sizeof(fbuf->buf);
-        if (!fbCollectMessage(fbuf->collector, fbuf->buf, &msglen, err)) {
+        /* A mapped file collector returns the message in place */
+        if (!fbCollectMessageMapped(fbuf->collector, &mapped, &msglen, err)) {
             return FALSE;
         }
+        if (mapped) {
+            fbuf->cp = mapped;
+        } else {
+            /* Borrow a message buffer of the size class of this message
+             * only once its header says how long it is */
+            if (!fbCollectMessageSize(fbuf->collector, &msglen, err)) {
+                return FALSE;
+            }
+            fBufAcquireMessageBuffer(fbuf, msglen);
+            msglen = (size_t)1 << (FB_MSGBUF_MIN_SHIFT + fbuf->buf_class);
+            fbuf->cp = fbuf->buf;
+            if (!fbCollectMessage(fbuf->collector, fbuf->buf, &msglen, err)) {
+                fBufReleaseMessageBuffer(fbuf);
+                fbuf->cp = NULL;
+                return FALSE;
+            }
+        }
     } else {
         if (fbuf->buflen) {
             if (!fbCollectMessageBuffer(fbuf->cp, fbuf->buflen, &msglen, err))
@@ -3649,7 +4444,7 @@ gboolean fBufNextMessage(
     fbuf->mep = fbuf->cp + msglen;
 
 #if FB_DEBUG_RD
-    fBufDebugHex("read", fbuf->buf, msglen);
+    fBufDebugHex("read", fbuf->cp, msglen);
 #endif
 #if FB_DEBUG_LWR
     fprintf(stderr, "read %lu (%04lx)\n", msglen, msglen);
@@ -4007,288 +4802,626 @@ static gboolean fBufConsumeInfoElementTypeRecord(
             return FALSE;
         }
 
-        /* Advance current record pointer by bytes read */
-        fbuf->cp += bufsize;
+        /* Advance current record pointer by bytes read */
+        fbuf->cp += bufsize;
+
+        /* Increment record count */
+        ++(fbuf->rc);
+    }
+
+    if (tid) {
+        if (!fBufSetInternalTemplate(fbuf, tid, err)) {
+            return FALSE;
+        }
+    } else {
+        fbuf->int_tid = tid;
+        fbuf->int_tmpl = NULL;
+    }
+
+
+    return TRUE;
+}
+
+
+
+
+/**
+ * fBufNextDataSet
+ *
+ *
+ *
+ *
+ *
+ */
+static fBufStatus_t fBufNextDataSet(
+    fBuf_t          *fbuf,
+    GError          **err)
+{
+    /* May have to consume multiple template sets */
+    for (;;) {
+        /* Normal end of message */
+        if (0 == FB_REM_MSG(fbuf)) {
+            return FB_STATUS_EOM;
+        }
+
+        /* Read the next set header */
+        if (!fBufNextSetHeader(fbuf, err)) {
+            return FB_STATUS_ERROR;
+        }
+
+        /* Check to see if we need to consume a template set */
+        if (fbuf->spec_tid) {
+            if (!fBufConsumeTemplateSet(fbuf, err)) {
+                return FB_STATUS_ERROR;
+            }
+            continue;
+        }
+
+        if (fbuf->auto_insert_tid) {
+            if (fbTemplateGetOptionsScope(fbuf->ext_tmpl)) {
+                if (fbInfoModelTypeInfoRecord(fbuf->ext_tmpl)) {
+                    if (!fBufConsumeInfoElementTypeRecord(fbuf, err)) {
+                        return FB_STATUS_ERROR;
+                    }
+                    continue;
+                }
+            }
+        }
+        /* All done. */
+        return FB_STATUS_OK;
+    }
+}
+
+
+/**
+ * fBufNextFinishMessage
+ *
+ * Called at end of message on the read side: stores the next expected
+ * sequence number and rewinds the buffer so the next read consumes a
+ * new message.
+ *
+ */
+static void     fBufNextFinishMessage(
+    fBuf_t          *fbuf)
+{
+#if HAVE_SPREAD
+    /* Only worry about sequence numbers for first group in list
+     * of received groups & only if we subscribe to that group*/
+    if (fbCollectorTestGroupMembership(fbuf->collector, 0)) {
+#endif
+        /* Store next expected sequence number */
+        fbSessionSetSequence(fbuf->session,
+                             fbSessionGetSequence(fbuf->session) +
+                             fbuf->rc);
+#if HAVE_SPREAD
+    }
+#endif
+    /* Rewind buffer to force next record read
+       to consume a new message. */
+    fBufRewind(fbuf);
+}
+
+
+/**
+ * fBufNextRecordSet
+ *
+ * Positions the buffer at the next record of a data set, reading a new
+ * message and consuming template sets as necessary.
+ *
+ */
+static fBufStatus_t fBufNextRecordSet(
+    fBuf_t          *fbuf,
+    GError          **err)
+{
+    /* Read a new message if necessary */
+    if (!fbuf->msgbase) {
+        if (!fBufNextMessage(fbuf, err)) {
+            return FB_STATUS_ERROR;
+        }
+    }
+
+    /* Skip any padding at end of current data set */
+    if (fbuf->setbase &&
+        (FB_REM_SET(fbuf) < fbuf->ext_tmpl->ie_len)) {
+        fBufSkipCurrentSet(fbuf);
+    }
+
+    /* Advance to the next data set if necessary */
+    if (!fbuf->setbase) {
+        return fBufNextDataSet(fbuf, err);
+    }
+
+    return FB_STATUS_OK;
+}
+
+
+/**
+ * fBufNextRetryable
+ *
+ * Handles a failed read.  At end of message, finishes the message and, in
+ * automatic mode, returns TRUE so the caller may retry the read in the
+ * next message.  Otherwise returns FALSE with `err` set.
+ *
+ */
+static gboolean fBufNextRetryable(
+    fBuf_t          *fbuf,
+    fBufStatus_t    status,
+    GError          **err)
+{
+    /* Fail if not EOM */
+    if (FB_STATUS_EOM != status &&
+        !g_error_matches(*err, FB_ERROR_DOMAIN, FB_ERROR_EOM))
+    {
+        return FALSE;
+    }
+
+    fBufNextFinishMessage(fbuf);
+
+    /* Clear error and try again in automatic mode */
+    if (fbuf->automatic) {
+        g_clear_error(err);
+        return TRUE;
+    }
+
+    if (FB_STATUS_EOM == status) {
+        g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_EOM,
+                    "End of message reading set header");
+    }
+    return FALSE;
+}
+
+
+/**
+ * fBufGetCollectionTemplate
+ *
+ *
+ *
+ *
+ *
+ */
+fbTemplate_t    *fBufGetCollectionTemplate(
+    fBuf_t          *fbuf,
+    uint16_t        *ext_tid)
+{
+    if (fbuf->ext_tmpl) {
+        if (ext_tid) *ext_tid = fbuf->ext_tid;
+    }
+    return fbuf->ext_tmpl;
+}
+
+
+/**
+ * fBufNextCollectionTemplate
+ *
+ *
+ *
+ *
+ *
+ */
+fbTemplate_t    *fBufNextCollectionTemplate(
+    fBuf_t          *fbuf,
+    uint16_t        *ext_tid,
+    GError          **err)
+{
+    fBufStatus_t    status;
+
+    g_assert(err);
+
+    while (1) {
+        /* Attempt to find the next record */
+        status = fBufNextRecordSet(fbuf, err);
+        if (FB_STATUS_OK == status) {
+            return fBufGetCollectionTemplate(fbuf, ext_tid);
+        }
+
+        /* Finish the message at EOM; retry in automatic mode */
+        if (!fBufNextRetryable(fbuf, status, err)) {
+            /* Error. Not EOM or not retryable. Fail. */
+            return NULL;
+        }
+    }
+}
+
+
+/**
+ * fBufNextSingle
+ *
+ *
+ *
+ *
+ *
+ */
+static fBufStatus_t fBufNextSingle(
+    fBuf_t          *fbuf,
+    uint8_t         *recbase,
+    size_t          *recsize,
+    GError          **err)
+{
+    size_t          bufsize;
+    fBufStatus_t    status;
+
+    /* Buffer must have active internal template */
+    g_assert(fbuf->int_tmpl);
 
-        /* Increment record count */
-        ++(fbuf->rc);
+    /* Find the next record, reading a message or set if necessary */
+    if ((status = fBufNextRecordSet(fbuf, err)) != FB_STATUS_OK) {
+        return status;
     }
 
-    if (tid) {
-        if (!fBufSetInternalTemplate(fbuf, tid, err)) {
-            return FALSE;
-        }
-    } else {
-        fbuf->int_tid = tid;
-        fbuf->int_tmpl = NULL;
-    }
+    /* Transcode bytes out of buffer */
+    bufsize = FB_REM_SET(fbuf);
 
+    if (!fbTranscode(fbuf, TRUE, fbuf->cp, recbase, &bufsize, recsize, err)) {
+        return FB_STATUS_ERROR;
+    }
 
-    return TRUE;
+    /* Advance current record pointer by bytes read */
+    fbuf->cp += bufsize;
+    /* Increment record count */
+    ++(fbuf->rc);
+#if FB_DEBUG_RD
+    fBufDebugBuffer("rrec", fbuf, bufsize, TRUE);
+#endif
+    /* Done */
+    return FB_STATUS_OK;
 }
 
 
-
-
 /**
- * fBufNextDataSet
+ * fBufNext
  *
  *
  *
  *
  *
  */
-static gboolean fBufNextDataSet(
+gboolean        fBufNext(
     fBuf_t          *fbuf,
+    uint8_t         *recbase,
+    size_t          *recsize,
     GError          **err)
 {
-    /* May have to consume multiple template sets */
-    for (;;) {
-        /* Read the next set header */
-        if (!fBufNextSetHeader(fbuf, err)) {
-            return FALSE;
-        }
+    fBufStatus_t    status;
 
-        /* Check to see if we need to consume a template set */
-        if (fbuf->spec_tid) {
-            if (!fBufConsumeTemplateSet(fbuf, err)) {
-                return FALSE;
-            }
-            continue;
-        }
+    g_assert(recbase);
+    g_assert(recsize);
+    g_assert(err);
 
-        if (fbuf->auto_insert_tid) {
-            if (fbTemplateGetOptionsScope(fbuf->ext_tmpl)) {
-                if (fbInfoModelTypeInfoRecord(fbuf->ext_tmpl)) {
-                    if (!fBufConsumeInfoElementTypeRecord(fbuf, err)) {
-                        return FALSE;
-                    }
-                    continue;
-                }
-            }
+    for (;;) {
+        /* Attempt single record read */
+        status = fBufNextSingle(fbuf, recbase, recsize, err);
+        if (FB_STATUS_OK == status) return TRUE;
+
+        /* Finish the message at EOM; retry in automatic mode */
+        if (!fBufNextRetryable(fbuf, status, err)) {
+            /* Error. Not EOM or not retryable. Fail. */
+            return FALSE;
         }
-        /* All done. */
-        return TRUE;
     }
 }
 
 
 /**
- * fBufGetCollectionTemplate
+ * fBufNextBatch
  *
  *
  *
  *
  *
  */
-fbTemplate_t    *fBufGetCollectionTemplate(
+gboolean        fBufNextBatch(
     fBuf_t          *fbuf,
-    uint16_t        *ext_tid)
+    uint8_t         *recbase,
+    size_t          stride,
+    size_t          max,
+    size_t          *count,
+    GError          **err)
 {
-    if (fbuf->ext_tmpl) {
-        if (ext_tid) *ext_tid = fbuf->ext_tid;
+    fbTranscodePlan_t   *tcplan;
+    size_t              bufsize;
+    size_t              recsize;
+
+    g_assert(recbase);
+    g_assert(count);
+    g_assert(err);
+
+    *count = 0;
+    if (0 == max) {
+        return TRUE;
     }
-    return fbuf->ext_tmpl;
+
+    /* Read the first record the normal way; this consumes any new
+     * message, template sets, and set header as required. */
+    recsize = stride;
+    if (!fBufNext(fbuf, recbase, &recsize, err)) {
+        return FALSE;
+    }
+    *count = 1;
+
+    /* Decode the rest of the current data set with the same plan */
+    tcplan = fbTranscodePlan(fbuf, fbuf->ext_tmpl, fbuf->int_tmpl);
+    while (*count < max && FB_REM_SET(fbuf) >= fbuf->ext_tmpl->ie_len) {
+        bufsize = FB_REM_SET(fbuf);
+        recsize = stride;
+        if (!fbTranscodeWithPlan(fbuf, tcplan, TRUE, fbuf->cp,
+                                 recbase + (*count * stride),
+                                 &bufsize, &recsize, err))
+        {
+            /* A truncated record ends the message as in fBufNext(), but
+             * the records already decoded point into the message; leave
+             * the message to the next call, which finishes it */
+            if (!g_error_matches(*err, FB_ERROR_DOMAIN, FB_ERROR_EOM)) {
+                return FALSE;
+            }
+            g_clear_error(err);
+            return TRUE;
+        }
+        fbuf->cp += bufsize;
+        ++(fbuf->rc);
+        ++(*count);
+    }
+
+    return TRUE;
 }
 
 
 /**
- * fBufNextCollectionTemplateSingle
+ * fBufNextViewSingle
  *
  *
  *
  *
  *
  */
-static fbTemplate_t    *fBufNextCollectionTemplateSingle(
+static fBufStatus_t fBufNextViewSingle(
     fBuf_t          *fbuf,
-    uint16_t        *ext_tid,
+    fbRecordView_t  *view,
     GError          **err)
 {
-    /* Read a new message if necessary */
-    if (!fbuf->msgbase) {
-        if (!fBufNextMessage(fbuf, err)) {
-            return FALSE;
-        }
+    uint16_t        *offsets;
+    ssize_t         reclen;
+    fBufStatus_t    status;
+
+    /* Find the next record, reading a message or set if necessary */
+    if ((status = fBufNextRecordSet(fbuf, err)) != FB_STATUS_OK) {
+        return status;
     }
 
-    /* Skip any padding at end of current data set */
-    if (fbuf->setbase &&
-        (FB_REM_SET(fbuf) < fbuf->ext_tmpl->ie_len)) {
-        fBufSkipCurrentSet(fbuf);
+    /* Make room for the offsets of a variable-length record */
+    if (fbuf->ext_tmpl->is_varlen &&
+        fbuf->view_offsets_len < fbuf->ext_tmpl->ie_count + 1U)
+    {
+        g_free(fbuf->view_offsets);
+        fbuf->view_offsets_len = fbuf->ext_tmpl->ie_count + 1;
+        fbuf->view_offsets = g_new(uint16_t, fbuf->view_offsets_len);
     }
 
-    /* Advance to the next data set if necessary */
-    if (!fbuf->setbase) {
-        if (!fBufNextDataSet(fbuf, err)) {
-            return FALSE;
-        }
+    /* Locate the fields of the record; cached for fixed-length templates */
+    reclen = fbTranscodeOffsets(fbuf->ext_tmpl, fbuf->cp, FB_REM_SET(fbuf),
+                                TRUE, fbuf->view_offsets, &offsets, err);
+    if (reclen < 0) {
+        return FB_STATUS_ERROR;
     }
 
-    return fBufGetCollectionTemplate(fbuf, ext_tid);
+    view->tmpl = fbuf->ext_tmpl;
+    view->base = fbuf->cp;
+    view->len = reclen;
+    view->offsets = offsets;
+
+    /* Advance current record pointer past the viewed record */
+    fbuf->cp += reclen;
+    /* Increment record count */
+    ++(fbuf->rc);
+#if FB_DEBUG_RD
+    fBufDebugBuffer("rvew", fbuf, reclen, TRUE);
+#endif
+    return FB_STATUS_OK;
 }
 
 
 /**
- * fBufNextCollectionTemplate
+ * fBufNextView
  *
  *
  *
  *
  *
  */
-fbTemplate_t    *fBufNextCollectionTemplate(
+gboolean        fBufNextView(
     fBuf_t          *fbuf,
-    uint16_t        *ext_tid,
+    fbRecordView_t  *view,
     GError          **err)
 {
-    fbTemplate_t    *tmpl;
+    fBufStatus_t    status;
 
+    g_assert(view);
     g_assert(err);
 
-    while (1) {
-        /* Attempt single record read */
-        if ((tmpl = fBufNextCollectionTemplateSingle(fbuf, ext_tid, err)))
-            return tmpl;
-
-        /* Finish the message at EOM */
-        if (g_error_matches(*err, FB_ERROR_DOMAIN, FB_ERROR_EOM)) {
-            /* Store next expected sequence number */
-#if HAVE_SPREAD
-            /* Only worry about sequence numbers for first group in list
-             * of received groups & only if we subscribe to that group*/
-            if (fbCollectorTestGroupMembership(fbuf->collector, 0)) {
-#endif
-
-            fbSessionSetSequence(fbuf->session,
-                                 fbSessionGetSequence(fbuf->session) +
-                                 fbuf->rc);
-#if HAVE_SPREAD
-            }
-#endif
-            /* Rewind buffer to force next record read
-               to consume a new message. */
-            fBufRewind(fbuf);
+    for (;;) {
+        /* Attempt single record view */
+        status = fBufNextViewSingle(fbuf, view, err);
+        if (FB_STATUS_OK == status) return TRUE;
 
-            /* Clear error and try again in automatic mode */
-            if (fbuf->automatic) {
-                g_clear_error(err);
-                continue;
-            }
+        /* Finish the message at EOM; retry in automatic mode */
+        if (!fBufNextRetryable(fbuf, status, err)) {
+            /* Error. Not EOM or not retryable. Fail. */
+            return FALSE;
         }
-
-        /* Error. Not EOM or not retryable. Fail. */
-        return NULL;
     }
 }
 
 
 /**
- * fBufNextSingle
+ * fBufTranscodeView
  *
  *
  *
  *
  *
  */
-static gboolean fBufNextSingle(
-    fBuf_t          *fbuf,
-    uint8_t         *recbase,
-    size_t          *recsize,
-    GError          **err)
+gboolean        fBufTranscodeView(
+    fBuf_t                 *fbuf,
+    const fbRecordView_t   *view,
+    uint8_t                *recbase,
+    size_t                 *recsize,
+    GError                 **err)
 {
-    size_t          bufsize;
+    fbTranscodePlan_t      *tcplan;
+    size_t                 bufsize;
 
     /* Buffer must have active internal template */
     g_assert(fbuf->int_tmpl);
+    g_assert(view->tmpl);
+    g_assert(recbase);
+    g_assert(recsize);
 
-    /* Read a new message if necessary */
-    if (!fbuf->msgbase) {
-        if (!fBufNextMessage(fbuf, err)) {
-            return FALSE;
-        }
-    }
+    tcplan = fbTranscodePlan(fbuf, view->tmpl, fbuf->int_tmpl);
+    bufsize = view->len;
 
-    /* Skip any padding at end of current data set */
-    if (fbuf->setbase &&
-        (FB_REM_SET(fbuf) < fbuf->ext_tmpl->ie_len)) {
-        fBufSkipCurrentSet(fbuf);
+    return fbTranscodeWithPlan(fbuf, tcplan, TRUE, view->base, recbase,
+                               &bufsize, recsize, err);
+}
+
+
+/**
+ * fbRecordViewFindElement
+ *
+ *
+ *
+ *
+ *
+ */
+gboolean        fbRecordViewFindElement(
+    const fbRecordView_t   *view,
+    const fbInfoElement_t  *ie,
+    uint16_t               *index)
+{
+    return fbTemplateFindIndex(view->tmpl, ie, index);
+}
+
+
+/**
+ * fbRecordViewGetVarfield
+ *
+ *
+ *
+ *
+ *
+ */
+gboolean        fbRecordViewGetVarfield(
+    const fbRecordView_t   *view,
+    uint16_t               index,
+    fbVarfield_t           *value)
+{
+    uint8_t                *fp;
+    size_t                 flen;
+
+    if (index >= view->tmpl->ie_count) {
+        return FALSE;
     }
 
-    /* Advance to the next data set if necessary */
-    if (!fbuf->setbase) {
-        if (!fBufNextDataSet(fbuf, err)) {
-            return FALSE;
+    fp = view->base + view->offsets[index];
+    flen = view->offsets[index + 1] - view->offsets[index];
+
+    /* Skip the length prefix of a variable-length field */
+    if (view->tmpl->ie_ary[index]->len == FB_IE_VARLEN) {
+        if (*fp == 255) {
+            fp += 3; flen -= 3;
+        } else {
+            fp += 1; flen -= 1;
         }
     }
 
-    /* Transcode bytes out of buffer */
-    bufsize = FB_REM_SET(fbuf);
+    value->buf = fp;
+    value->len = flen;
+    return TRUE;
+}
 
-    if (!fbTranscode(fbuf, TRUE, fbuf->cp, recbase, &bufsize, recsize, err)) {
+
+/**
+ * fbRecordViewGetUnsigned
+ *
+ *
+ *
+ *
+ *
+ */
+gboolean        fbRecordViewGetUnsigned(
+    const fbRecordView_t   *view,
+    uint16_t               index,
+    uint64_t               *value)
+{
+    const uint8_t          *fp;
+    uint16_t               flen, i;
+    uint16_t               u16;
+    uint32_t               u32;
+    uint64_t               v;
+
+    if (index >= view->tmpl->ie_count) {
         return FALSE;
     }
 
-    /* Advance current record pointer by bytes read */
-    fbuf->cp += bufsize;
-    /* Increment record count */
-    ++(fbuf->rc);
-#if FB_DEBUG_RD
-    fBufDebugBuffer("rrec", fbuf, bufsize, TRUE);
-#endif
-    /* Done */
+    /* Only fixed-length fields of up to eight octets hold an integer */
+    flen = view->tmpl->ie_ary[index]->len;
+    if (flen == FB_IE_VARLEN || flen == 0 || flen > sizeof(uint64_t)) {
+        return FALSE;
+    }
+
+    /* Swap just this field out of network byte order */
+    fp = view->base + view->offsets[index];
+    switch (flen) {
+      case 1:
+        v = *fp;
+        break;
+      case 2:
+        FB_READ_U16(u16, fp);
+        v = u16;
+        break;
+      case 4:
+        FB_READ_U32(u32, fp);
+        v = u32;
+        break;
+      default:
+        /* 8 octets, or reduced-length encoding of a wider type */
+        for (i = 0, v = 0; i < flen; i++) {
+            v = (v << 8) | fp[i];
+        }
+        break;
+    }
+
+    *value = v;
     return TRUE;
 }
 
 
 /**
- * fBufNext
+ * fbRecordViewGetSigned
  *
  *
  *
  *
  *
  */
-gboolean        fBufNext(
-    fBuf_t          *fbuf,
-    uint8_t         *recbase,
-    size_t          *recsize,
-    GError          **err)
+gboolean        fbRecordViewGetSigned(
+    const fbRecordView_t   *view,
+    uint16_t               index,
+    int64_t                *value)
 {
-    g_assert(recbase);
-    g_assert(recsize);
-    g_assert(err);
-
-    for (;;) {
-        /* Attempt single record read */
-        if (fBufNextSingle(fbuf, recbase, recsize, err)) return TRUE;
-        /* Finish the message at EOM */
-        if (g_error_matches(*err, FB_ERROR_DOMAIN, FB_ERROR_EOM)) {
-#if HAVE_SPREAD
-            /* Only worry about sequence numbers for first group in list
-             * of received groups & only if we subscribe to that group*/
-            if (fbCollectorTestGroupMembership(fbuf->collector, 0)) {
-#endif
-                /* Store next expected sequence number */
-                fbSessionSetSequence(fbuf->session,
-                                     fbSessionGetSequence(fbuf->session) +
-                                     fbuf->rc);
-#if HAVE_SPREAD
-            }
-#endif
-            /* Rewind buffer to force next record read
-               to consume a new message. */
-            fBufRewind(fbuf);
-            /* Clear error and try again in automatic mode */
-            if (fbuf->automatic) {
-                g_clear_error(err);
-                continue;
-            }
-        }
+    uint64_t               v;
+    uint16_t               flen;
 
-        /* Error. Not EOM or not retryable. Fail. */
+    if (!fbRecordViewGetUnsigned(view, index, &v)) {
         return FALSE;
     }
+
+    /* Sign-extend reduced-length values */
+    flen = view->tmpl->ie_ary[index]->len;
+    if (flen < sizeof(uint64_t) && (v & (UINT64_C(1) << (flen * 8 - 1)))) {
+        v |= ~UINT64_C(0) << (flen * 8);
+    }
+
+    *value = (int64_t)v;
+    return TRUE;
 }
 
 
@@ -5242,3 +6375,51 @@ void fBufListFree(
         }
     }
 }
+
+/**
+ * fBufSetListArena
+ *
+ *
+ */
+void fBufSetListArena(
+    fBuf_t           *fbuf,
+    size_t            block_size)
+{
+    fBufListArenaFree(fbuf);
+    fbuf->arena_block_size = block_size;
+}
+
+/**
+ * fBufResetListArena
+ *
+ * Releases all list storage handed out since the last reset.  When the
+ * storage spilled over into more than one block, the blocks are replaced
+ * with a single block large enough to hold all of it, so that a steady
+ * workload settles on one block.
+ */
+void fBufResetListArena(
+    fBuf_t           *fbuf)
+{
+    fbListArenaBlock_t *block;
+    size_t              size = 0;
+
+    if (!(block = fbuf->arena)) {
+        return;
+    }
+
+    if (!block->next) {
+        block->used = 0;
+        return;
+    }
+
+    for (; block; block = block->next) {
+        size += block->size;
+    }
+    fBufListArenaFree(fbuf);
+
+    block = g_malloc(FB_LIST_ARENA_HDR + size);
+    block->size = size;
+    block->used = 0;
+    block->next = NULL;
+    fbuf->arena = block;
+}